@@ -0,0 +1,293 @@
+/*
+ * Copyright (C) 2026 pkg-config contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/* A minimal ELF symbol table reader.  Fields are read by offset rather
+ * than through the <elf.h> structures so that it works for both ELF
+ * classes and byte orders on any host, and on archive members, which
+ * are only 2-byte aligned.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "pkg.h"
+#include "elfsyms.h"
+
+#include <string.h>
+#include <stdlib.h>
+
+#define ELFCLASS32     1
+#define ELFCLASS64     2
+#define ELFDATA2LSB    1
+#define ELFDATA2MSB    2
+#define ET_REL         1
+#define SHT_SYMTAB     2
+#define SHT_DYNSYM     11
+#define SHN_UNDEF      0
+#define STB_GLOBAL     1
+#define STB_WEAK       2
+#define STB_GNU_UNIQUE 10
+#define STT_SECTION    3
+#define STT_FILE       4
+
+#define SYM32_SIZE     16
+#define SYM64_SIZE     24
+
+#define AR_MAGIC       "!<arch>\n"
+#define AR_MAGIC_LEN   8
+#define AR_HEADER_LEN  60
+
+typedef struct
+{
+  const guchar *data;
+  gsize len;
+  gboolean is64;
+  gboolean little_endian;
+} ElfFile;
+
+static guint64
+elf_get (const ElfFile *elf, gsize offset, int size)
+{
+  guint64 val = 0;
+  int i;
+
+  if (offset > elf->len || (gsize) size > elf->len - offset)
+    return 0;
+
+  /* accumulate from the most significant byte */
+  for (i = 0; i < size; i++)
+    {
+      int idx = elf->little_endian ? size - 1 - i : i;
+      val = (val << 8) | elf->data[offset + idx];
+    }
+
+  return val;
+}
+
+static gboolean
+elf_scan (const guchar *data, gsize len, gboolean want_defined,
+          GHashTable *syms)
+{
+  ElfFile elf;
+  guint64 shoff;
+  guint64 shnum;
+  guint64 shentsize;
+  guint64 i;
+  int type;
+  int wanted;
+  gboolean found = FALSE;
+
+  if (len < 52 || memcmp (data, "\177ELF", 4) != 0)
+    return FALSE;
+
+  elf.data = data;
+  elf.len = len;
+  elf.is64 = data[4] == ELFCLASS64;
+  elf.little_endian = data[5] == ELFDATA2LSB;
+
+  if ((data[4] != ELFCLASS32 && data[4] != ELFCLASS64) ||
+      (data[5] != ELFDATA2LSB && data[5] != ELFDATA2MSB))
+    return FALSE;
+
+  type = elf_get (&elf, 16, 2);
+  if (elf.is64)
+    {
+      shoff = elf_get (&elf, 40, 8);
+      shentsize = elf_get (&elf, 58, 2);
+      shnum = elf_get (&elf, 60, 2);
+    }
+  else
+    {
+      shoff = elf_get (&elf, 32, 4);
+      shentsize = elf_get (&elf, 46, 2);
+      shnum = elf_get (&elf, 48, 2);
+    }
+
+  if (shoff == 0 || shentsize == 0 || shoff >= len)
+    return FALSE;
+
+  /* extended section numbering: the count is in section 0's sh_size */
+  if (shnum == 0)
+    shnum = elf_get (&elf, shoff + (elf.is64 ? 32 : 20), elf.is64 ? 8 : 4);
+
+  /* Relocatable objects only have a full symbol table; for linked files
+   * the dynamic symbol table is what matters. */
+  wanted = (type == ET_REL) ? SHT_SYMTAB : SHT_DYNSYM;
+
+ again:
+  for (i = 0; i < shnum; i++)
+    {
+      gsize sh = shoff + i * shentsize;
+      guint64 sh_type, sh_offset, sh_size, sh_link, sh_entsize;
+      guint64 str_offset, str_size;
+      gsize strsh;
+      guint64 j;
+
+      if (sh > len || shentsize > len - sh)
+        break;
+
+      sh_type = elf_get (&elf, sh + 4, 4);
+      if (sh_type != wanted)
+        continue;
+
+      if (elf.is64)
+        {
+          sh_offset = elf_get (&elf, sh + 24, 8);
+          sh_size = elf_get (&elf, sh + 32, 8);
+          sh_link = elf_get (&elf, sh + 40, 4);
+          sh_entsize = elf_get (&elf, sh + 56, 8);
+        }
+      else
+        {
+          sh_offset = elf_get (&elf, sh + 16, 4);
+          sh_size = elf_get (&elf, sh + 20, 4);
+          sh_link = elf_get (&elf, sh + 24, 4);
+          sh_entsize = elf_get (&elf, sh + 36, 4);
+        }
+
+      /* The values come from the file, so the sums checked against its
+       * length could wrap around */
+      if (sh_link >= shnum ||
+          sh_entsize < (elf.is64 ? SYM64_SIZE : SYM32_SIZE) ||
+          sh_entsize > sh_size)
+        continue;
+
+      strsh = shoff + sh_link * shentsize;
+      str_offset = elf_get (&elf, strsh + (elf.is64 ? 24 : 16),
+                            elf.is64 ? 8 : 4);
+      str_size = elf_get (&elf, strsh + (elf.is64 ? 32 : 20),
+                          elf.is64 ? 8 : 4);
+      if (str_offset > len || str_size > len - str_offset ||
+          sh_offset > len || sh_size > len - sh_offset)
+        continue;
+
+      found = TRUE;
+
+      for (j = 0; j < sh_size / sh_entsize; j++)
+        {
+          gsize sym = sh_offset + j * sh_entsize;
+          guint64 st_name;
+          int st_info, st_shndx, bind, stype;
+          const char *name;
+
+          if (elf.is64)
+            {
+              st_name = elf_get (&elf, sym, 4);
+              st_info = elf_get (&elf, sym + 4, 1);
+              st_shndx = elf_get (&elf, sym + 6, 2);
+            }
+          else
+            {
+              st_name = elf_get (&elf, sym, 4);
+              st_info = elf_get (&elf, sym + 12, 1);
+              st_shndx = elf_get (&elf, sym + 14, 2);
+            }
+
+          bind = st_info >> 4;
+          stype = st_info & 0xf;
+          if (bind != STB_GLOBAL && bind != STB_WEAK && bind != STB_GNU_UNIQUE)
+            continue;
+          if (stype == STT_SECTION || stype == STT_FILE)
+            continue;
+          if ((st_shndx == SHN_UNDEF) == want_defined)
+            continue;
+          if (st_name == 0 || st_name >= str_size)
+            continue;
+
+          name = (const char *) data + str_offset + st_name;
+          if (memchr (name, '\0', str_size - st_name) == NULL || *name == '\0')
+            continue;
+
+          g_hash_table_add (syms, g_strdup (name));
+        }
+    }
+
+  /* Linked files without a dynamic symbol table, e.g. static
+   * executables, can still have a full one. */
+  if (!found && wanted == SHT_DYNSYM)
+    {
+      wanted = SHT_SYMTAB;
+      goto again;
+    }
+
+  return found;
+}
+
+static gboolean
+ar_scan (const guchar *data, gsize len, gboolean want_defined,
+         GHashTable *syms)
+{
+  gsize offset = AR_MAGIC_LEN;
+  gboolean found = FALSE;
+
+  while (offset + AR_HEADER_LEN <= len)
+    {
+      char sizebuf[11];
+      gsize size;
+
+      memcpy (sizebuf, data + offset + 48, 10);
+      sizebuf[10] = '\0';
+      size = strtoul (sizebuf, NULL, 10);
+      offset += AR_HEADER_LEN;
+
+      if (size > len - offset)
+        break;
+
+      /* the symbol index and long name table aren't ELF and are
+       * skipped by elf_scan */
+      if (elf_scan (data + offset, size, want_defined, syms))
+        found = TRUE;
+
+      offset += size + (size & 1);
+    }
+
+  return found;
+}
+
+gboolean
+elf_read_symbols (const char *path, gboolean want_defined, GHashTable *syms)
+{
+  GMappedFile *file;
+  const guchar *data;
+  gsize len;
+  gboolean retval;
+
+  file = g_mapped_file_new (path, FALSE, NULL);
+  if (file == NULL)
+    {
+      debug_log (LOG_FLAGS, "Cannot read '%s' for its symbols\n", path);
+      return FALSE;
+    }
+
+  data = (const guchar *) g_mapped_file_get_contents (file);
+  len = g_mapped_file_get_length (file);
+
+  if (len >= AR_MAGIC_LEN && memcmp (data, AR_MAGIC, AR_MAGIC_LEN) == 0)
+    retval = ar_scan (data, len, want_defined, syms);
+  else
+    retval = elf_scan (data, len, want_defined, syms);
+
+  g_mapped_file_unref (file);
+
+  if (!retval)
+    debug_log (LOG_FLAGS, "No ELF symbol table in '%s'\n", path);
+
+  return retval;
+}
@@ -0,0 +1,34 @@
+/*
+ * Copyright (C) 2026 pkg-config contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef PKG_CONFIG_ELFSYMS_H
+#define PKG_CONFIG_ELFSYMS_H
+
+#include <glib.h>
+
+/* Add the global symbol names of the ELF file PATH to SYMS, a set of
+ * strings that frees its keys.  If WANT_DEFINED, the symbols the file
+ * defines are added, otherwise the ones it needs.  PATH may be an
+ * object file, a shared library, an executable or an ar archive of
+ * object files.  Returns FALSE if PATH could not be read as ELF.
+ */
+gboolean elf_read_symbols (const char *path, gboolean want_defined,
+                           GHashTable *syms);
+
+#endif
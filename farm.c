@@ -0,0 +1,444 @@
+/*
+ * Copyright (C) 2026 pkg-config contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/* An include farm is a single directory that merges a list of include
+ * directories, so that the compiler probes one directory per #include
+ * instead of one per -I flag.  Directories are recreated, files are
+ * symlinked (or hardlinked if symlinks are not allowed).  A file found
+ * in two directories cannot be represented, since #include_next in the
+ * first one would no longer find the second; neither can a name that
+ * is a file in one directory and a subdirectory in another, nor
+ * anything on platforms without links.  In those cases no farm is made.
+ *
+ * Farms live in CACHEDIR/<list>-<state>, where <list> is a fingerprint
+ * of the ordered list of directories and <state> one of the
+ * modification times of every directory under them, which change when
+ * a header is added or removed anywhere in the tree.  A farm is built
+ * in a temporary directory and renamed into place, so concurrent
+ * builds either see a complete farm or none.  Once built, the farms of
+ * the same list with an older state are removed.  When the directories
+ * cannot be represented, that is recorded too, so that the trees are
+ * only walked again once one of the directories read has changed.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "pkg.h"
+#include "farm.h"
+
+#include <glib/gstdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#ifdef HAVE_SYMLINK
+
+#define FARM_DIR  GINT_TO_POINTER (1)
+#define FARM_FILE GINT_TO_POINTER (2)
+
+/* The farm name recorded for directories that cannot be represented */
+#define FARM_NONE "-"
+
+typedef enum
+{
+  FARM_ADD_OK,
+  FARM_ADD_CONFLICT,
+  FARM_ADD_FAILED
+} FarmAddResult;
+
+/* The name of the list of directories DIRS.  The farm for DIRS is
+ * named after it and a checksum of the directories it was built from;
+ * "NAME.dirs" names the current farm on its first line, or FARM_NONE,
+ * followed by each source directory with its modification time as
+ * "MTIME\tDIR". */
+static char *
+farm_list_name (GList *dirs)
+{
+  GChecksum *sum = g_checksum_new (G_CHECKSUM_SHA1);
+  char *retval;
+
+  for (; dirs != NULL; dirs = g_list_next (dirs))
+    {
+      const char *dir = dirs->data;
+
+      g_checksum_update (sum, (const guchar *) dir, strlen (dir) + 1);
+    }
+
+  retval = g_strdup (g_checksum_get_string (sum));
+  g_checksum_free (sum);
+
+  return retval;
+}
+
+/* Return the name of the farm recorded in MANIFEST if none of its
+ * source directories has changed since.  Only directories are checked,
+ * as adding or removing a header changes the directory holding it.  A
+ * directory modified in the same second as the manifest may have
+ * changed after it was written, so it counts as changed. */
+static char *
+farm_check_manifest (const char *manifest)
+{
+  struct stat st;
+  char *contents;
+  char **lines;
+  char **line;
+  char *retval = NULL;
+  gboolean ok;
+
+  if (g_stat (manifest, &st) != 0 ||
+      !g_file_get_contents (manifest, &contents, NULL, NULL))
+    return NULL;
+
+  lines = g_strsplit (contents, "\n", -1);
+  g_free (contents);
+
+  ok = lines[0] != NULL && *lines[0] != '\0';
+  for (line = lines + 1; ok && *line != NULL; line++)
+    {
+      char *tab = strchr (*line, '\t');
+      struct stat dirst;
+      char *mtime;
+
+      if (**line == '\0')
+        continue;
+      if (tab == NULL)
+        {
+          ok = FALSE;
+          break;
+        }
+
+      *tab = '\0';
+      if (g_stat (tab + 1, &dirst) != 0 || dirst.st_mtime >= st.st_mtime)
+        ok = FALSE;
+      else
+        {
+          mtime = g_strdup_printf ("%ld", (long) dirst.st_mtime);
+          ok = strcmp (mtime, *line) == 0;
+          g_free (mtime);
+        }
+      if (!ok)
+        debug_log (LOG_FLAGS, "Include directory '%s' changed\n", tab + 1);
+    }
+
+  if (ok)
+    retval = g_strdup (lines[0]);
+  g_strfreev (lines);
+
+  return retval;
+}
+
+static void
+remove_tree (const char *path)
+{
+  GDir *dir;
+  const gchar *name;
+  struct stat st;
+
+  if (g_lstat (path, &st) != 0)
+    return;
+
+  if (S_ISDIR (st.st_mode) && (dir = g_dir_open (path, 0, NULL)) != NULL)
+    {
+      while ((name = g_dir_read_name (dir)))
+        {
+          char *child = g_build_filename (path, name, NULL);
+          remove_tree (child);
+          g_free (child);
+        }
+      g_dir_close (dir);
+      g_rmdir (path);
+    }
+  else
+    g_unlink (path);
+}
+
+/* Merge SRC/REL into FARM/REL.  ENTRIES maps relative names already in
+ * the farm to FARM_DIR or FARM_FILE.  Each directory read is added to
+ * MANIFEST with its modification time.  Symlinks, including those to
+ * directories, are linked into the farm as they are rather than
+ * followed, so that a symlink loop cannot make the walk endless.  On a
+ * conflict, the directories holding both sides are in MANIFEST, so it
+ * stays until one of them changes. */
+static FarmAddResult
+farm_add_dir (const char *farm, const char *src, const char *rel,
+              GHashTable *entries, GString *manifest)
+{
+  GDir *dir;
+  const gchar *name;
+  char *srcdir;
+  struct stat st;
+  FarmAddResult result = FARM_ADD_OK;
+
+  srcdir = rel ? g_build_filename (src, rel, NULL) : g_strdup (src);
+  dir = g_dir_open (srcdir, 0, NULL);
+  if (dir == NULL)
+    {
+      g_free (srcdir);
+      return FARM_ADD_OK;
+    }
+
+  if (g_stat (srcdir, &st) == 0 && strchr (srcdir, '\n') == NULL)
+    g_string_append_printf (manifest, "%ld\t%s\n", (long) st.st_mtime,
+                            srcdir);
+
+  while (result == FARM_ADD_OK && (name = g_dir_read_name (dir)))
+    {
+      char *srcpath = g_build_filename (srcdir, name, NULL);
+      char *relpath = rel ? g_build_filename (rel, name, NULL) : g_strdup (name);
+      char *dest;
+      gpointer have;
+
+      if (g_lstat (srcpath, &st) != 0)
+        {
+          g_free (srcpath);
+          g_free (relpath);
+          continue;
+        }
+
+      have = g_hash_table_lookup (entries, relpath);
+      dest = g_build_filename (farm, relpath, NULL);
+
+      if (S_ISDIR (st.st_mode))
+        {
+          if (have == FARM_FILE)
+            {
+              debug_log (LOG_FLAGS,
+                         "Include farm conflict: '%s' is a directory in "
+                         "'%s' but a file in an earlier directory\n",
+                         relpath, src);
+              result = FARM_ADD_CONFLICT;
+            }
+          else
+            {
+              if (have == NULL)
+                {
+                  if (g_mkdir (dest, 0755) != 0)
+                    result = FARM_ADD_FAILED;
+                  g_hash_table_insert (entries, g_strdup (relpath), FARM_DIR);
+                }
+              if (result == FARM_ADD_OK)
+                result = farm_add_dir (farm, src, relpath, entries, manifest);
+            }
+        }
+      else if (have == FARM_DIR)
+        {
+          debug_log (LOG_FLAGS,
+                     "Include farm conflict: '%s' is a file in '%s' but "
+                     "a directory in an earlier directory\n", relpath, src);
+          result = FARM_ADD_CONFLICT;
+        }
+      else if (have == FARM_FILE)
+        {
+          debug_log (LOG_FLAGS,
+                     "Include farm conflict: '%s' in '%s' is shadowed by "
+                     "an earlier directory, which #include_next needs\n",
+                     relpath, src);
+          result = FARM_ADD_CONFLICT;
+        }
+      else
+        {
+          if (symlink (srcpath, dest) != 0 && link (srcpath, dest) != 0)
+            {
+              debug_log (LOG_FLAGS, "Cannot link '%s' into include farm: %s\n",
+                         srcpath, g_strerror (errno));
+              result = FARM_ADD_FAILED;
+            }
+          g_hash_table_insert (entries, g_strdup (relpath), FARM_FILE);
+        }
+
+      g_free (dest);
+      g_free (srcpath);
+      g_free (relpath);
+    }
+
+  g_dir_close (dir);
+  g_free (srcdir);
+
+  return result;
+}
+
+/* Remove the farms in CACHEDIR for the same list of directories as
+ * FINGERPRINT, whose first LIST_LEN characters name the list, but
+ * another state.  Farms still being built have a suffix and are left
+ * alone. */
+static void
+remove_superseded (const char *cachedir, const char *fingerprint,
+                   gsize list_len)
+{
+  GDir *dir = g_dir_open (cachedir, 0, NULL);
+  const gchar *name;
+
+  if (dir == NULL)
+    return;
+  while ((name = g_dir_read_name (dir)))
+    if (strncmp (name, fingerprint, list_len) == 0 &&
+        strcmp (name, fingerprint) != 0 && strchr (name, '.') == NULL)
+      {
+        char *path = g_build_filename (cachedir, name, NULL);
+
+        debug_log (LOG_FLAGS, "Removing superseded include farm '%s'\n",
+                   path);
+        remove_tree (path);
+        g_free (path);
+      }
+  g_dir_close (dir);
+}
+
+char *
+include_farm_get (GList *dirs, const char *cachedir)
+{
+  char *list_name;
+  char *manifest_path;
+  char *fingerprint;
+  char *farm = NULL;
+  char *tmpfarm;
+  char *state;
+  GHashTable *entries;
+  GString *manifest;
+  GList *iter;
+  GError *error = NULL;
+  FarmAddResult result = FARM_ADD_OK;
+  gboolean ok;
+
+  list_name = farm_list_name (dirs);
+  manifest_path = g_strconcat (cachedir, G_DIR_SEPARATOR_S, list_name,
+                               ".dirs", NULL);
+
+  if ((fingerprint = farm_check_manifest (manifest_path)) != NULL &&
+      strcmp (fingerprint, FARM_NONE) == 0)
+    {
+      debug_log (LOG_FLAGS, "Include farm cannot represent the directories, "
+                 "not using one\n");
+      g_free (fingerprint);
+      g_free (manifest_path);
+      g_free (list_name);
+      return NULL;
+    }
+  if (fingerprint != NULL)
+    {
+      farm = g_build_filename (cachedir, fingerprint, NULL);
+      g_free (fingerprint);
+      if (g_file_test (farm, G_FILE_TEST_IS_DIR))
+        {
+          debug_log (LOG_FLAGS, "Using existing include farm '%s'\n", farm);
+          g_free (manifest_path);
+          g_free (list_name);
+          return farm;
+        }
+      g_free (farm);
+      farm = NULL;
+    }
+
+  if (g_mkdir_with_parents (cachedir, 0755) != 0)
+    {
+      debug_log (LOG_FLAGS, "Cannot create include farm cache '%s': %s\n",
+                 cachedir, g_strerror (errno));
+      g_free (manifest_path);
+      g_free (list_name);
+      return NULL;
+    }
+
+  tmpfarm = g_strconcat (cachedir, G_DIR_SEPARATOR_S, list_name, ".XXXXXX",
+                         NULL);
+  if (g_mkdtemp (tmpfarm) == NULL)
+    {
+      debug_log (LOG_FLAGS, "Cannot create include farm in '%s': %s\n",
+                 cachedir, g_strerror (errno));
+      g_free (tmpfarm);
+      g_free (manifest_path);
+      g_free (list_name);
+      return NULL;
+    }
+  g_chmod (tmpfarm, 0755);
+
+  entries = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  manifest = g_string_new (NULL);
+  for (iter = dirs; result == FARM_ADD_OK && iter != NULL;
+       iter = g_list_next (iter))
+    result = farm_add_dir (tmpfarm, iter->data, NULL, entries, manifest);
+  g_hash_table_destroy (entries);
+  ok = result == FARM_ADD_OK;
+
+  /* The farm is named after the directories it was built from, so
+   * that users of a superseded farm keep a consistent one until it is
+   * removed. */
+  state = g_compute_checksum_for_string (G_CHECKSUM_SHA1, manifest->str, -1);
+  fingerprint = g_strconcat (list_name, "-",
+                             result == FARM_ADD_CONFLICT ? FARM_NONE : state,
+                             NULL);
+  g_free (state);
+
+  if (ok)
+    {
+      farm = g_build_filename (cachedir, fingerprint, NULL);
+      debug_log (LOG_FLAGS, "Building include farm '%s'\n", farm);
+
+      /* Somebody else may have finished the same farm in the meantime,
+       * which is just as good. */
+      if (g_rename (tmpfarm, farm) != 0 &&
+          !g_file_test (farm, G_FILE_TEST_IS_DIR))
+        ok = FALSE;
+    }
+
+  if (ok || result == FARM_ADD_CONFLICT)
+    {
+      g_string_prepend_c (manifest, '\n');
+      g_string_prepend (manifest, ok ? fingerprint : FARM_NONE);
+      if (!g_file_set_contents (manifest_path, manifest->str, manifest->len,
+                                &error))
+        {
+          debug_log (LOG_FLAGS, "Cannot write '%s': %s\n", manifest_path,
+                     error->message);
+          g_error_free (error);
+        }
+      remove_superseded (cachedir, fingerprint, strlen (list_name) + 1);
+    }
+  if (!ok)
+    {
+      debug_log (LOG_FLAGS, "Not using an include farm\n");
+      g_free (farm);
+      farm = NULL;
+    }
+
+  remove_tree (tmpfarm);
+  g_free (tmpfarm);
+  g_string_free (manifest, TRUE);
+  g_free (fingerprint);
+  g_free (manifest_path);
+  g_free (list_name);
+
+  return farm;
+}
+
+#else /* !HAVE_SYMLINK */
+
+char *
+include_farm_get (GList *dirs, const char *cachedir)
+{
+  debug_log (LOG_FLAGS, "Include farms are not supported on this platform\n");
+  return NULL;
+}
+
+#endif
@@ -0,0 +1,33 @@
+/*
+ * Copyright (C) 2026 pkg-config contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef PKG_CONFIG_FARM_H
+#define PKG_CONFIG_FARM_H
+
+#include <glib.h>
+
+/* Return the path of an include farm under CACHEDIR merging DIRS (a
+ * list of absolute include directories in search order), building it if
+ * needed.
+ * Returns NULL if the farm cannot represent DIRS, in which case the
+ * caller should fall back to the plain -I flags.
+ */
+char *include_farm_get (GList *dirs, const char *cachedir);
+
+#endif
@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2026 pkg-config contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "pkg.h"
+#include "includes.h"
+
+#include <glib/gstdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+typedef struct
+{
+  char *path;
+  GPtrArray *includes;
+} ScanJob;
+
+static const char *
+skip_blanks (const char *p, const char *end)
+{
+  while (p < end && (*p == ' ' || *p == '\t'))
+    p++;
+  return p;
+}
+
+/* Add the <...> header of each #include line in DATA to INCLUDES */
+static void
+scan_buffer (const char *data, gsize len, GPtrArray *includes)
+{
+  const char *end = data + len;
+  const char *line = data;
+
+  while (line < end)
+    {
+      const char *eol = memchr (line, '\n', end - line);
+      const char *p;
+      const char *close;
+
+      if (eol == NULL)
+        eol = end;
+
+      p = skip_blanks (line, eol);
+      if (p < eol && *p == '#')
+        {
+          p = skip_blanks (p + 1, eol);
+          if (eol - p > 7 && strncmp (p, "include", 7) == 0)
+            {
+              p += 7;
+              if (eol - p > 5 && strncmp (p, "_next", 5) == 0)
+                p += 5;
+              p = skip_blanks (p, eol);
+              if (p < eol && *p == '<' &&
+                  (close = memchr (p, '>', eol - p)) != NULL &&
+                  close > p + 1)
+                g_ptr_array_add (includes, g_strndup (p + 1, close - p - 1));
+            }
+        }
+
+      line = eol + 1;
+    }
+}
+
+static void
+scan_job (gpointer data, gpointer user_data)
+{
+  ScanJob *job = data;
+  char *contents;
+  gsize len;
+
+  if (!g_file_get_contents (job->path, &contents, &len, NULL))
+    return;
+
+  scan_buffer (contents, len, job->includes);
+  g_free (contents);
+}
+
+/* Append a ScanJob for each regular file below DIR to JOBS.  Symlinked
+ * directories are not followed, as they may loop. */
+static void
+collect_files (const char *dir, GPtrArray *jobs)
+{
+  GDir *gdir;
+  const gchar *name;
+
+  gdir = g_dir_open (dir, 0, NULL);
+  if (gdir == NULL)
+    return;
+
+  while ((name = g_dir_read_name (gdir)))
+    {
+      char *path = g_build_filename (dir, name, NULL);
+      struct stat st;
+
+      if (g_lstat (path, &st) == 0 && S_ISDIR (st.st_mode))
+        collect_files (path, jobs);
+      else if (g_file_test (path, G_FILE_TEST_IS_REGULAR))
+        {
+          ScanJob *job = g_new0 (ScanJob, 1);
+
+          job->path = path;
+          job->includes = g_ptr_array_new_with_free_func (g_free);
+          g_ptr_array_add (jobs, job);
+          continue;
+        }
+
+      g_free (path);
+    }
+
+  g_dir_close (gdir);
+}
+
+GList *
+scan_includes (GList *dirs)
+{
+  GPtrArray *jobs;
+  GThreadPool *pool = NULL;
+  GHashTable *seen;
+  GList *includes = NULL;
+  GList *tmp;
+  guint threads;
+  guint i;
+  guint j;
+
+  jobs = g_ptr_array_new ();
+  for (tmp = dirs; tmp != NULL; tmp = g_list_next (tmp))
+    collect_files (tmp->data, jobs);
+
+  threads = MIN (g_get_num_processors (), jobs->len);
+  if (threads > 1)
+    pool = g_thread_pool_new (scan_job, NULL, threads, TRUE, NULL);
+
+  debug_log (LOG_GRAPH, "Scanning %u headers for includes with %u threads\n",
+             jobs->len, pool ? threads : 1);
+  for (i = 0; i < jobs->len; i++)
+    {
+      if (pool != NULL)
+        g_thread_pool_push (pool, g_ptr_array_index (jobs, i), NULL);
+      else
+        scan_job (g_ptr_array_index (jobs, i), NULL);
+    }
+  if (pool != NULL)
+    g_thread_pool_free (pool, FALSE, TRUE);
+
+  seen = g_hash_table_new (g_str_hash, g_str_equal);
+  for (i = 0; i < jobs->len; i++)
+    {
+      ScanJob *job = g_ptr_array_index (jobs, i);
+
+      for (j = 0; j < job->includes->len; j++)
+        {
+          char *name = g_ptr_array_index (job->includes, j);
+
+          if (g_hash_table_contains (seen, name))
+            continue;
+          name = g_strdup (name);
+          g_hash_table_add (seen, name);
+          includes = g_list_prepend (includes, name);
+        }
+
+      g_ptr_array_free (job->includes, TRUE);
+      g_free (job->path);
+      g_free (job);
+    }
+  g_hash_table_destroy (seen);
+  g_ptr_array_free (jobs, TRUE);
+
+  return g_list_sort (includes, (GCompareFunc) strcmp);
+}
@@ -0,0 +1,206 @@
+/*
+ * Copyright (C) 2026 pkg-config contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/* The debug and error log.  Writing each message with its own
+ * allocation and fflush made --debug on a large graph an order of
+ * magnitude slower, so messages are formatted into a scratch buffer
+ * that is reused, collected in an output buffer and written in batches.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "log.h"
+#include "json.h"
+
+#include <string.h>
+#include <stdlib.h>
+
+/* Bytes collected before they are written */
+#define LOG_BATCH 8192
+
+static const char *category_names[N_LOG_CATEGORIES] = {
+  "general",
+  "lookup",
+  "parse",
+  "graph",
+  "flags",
+};
+
+static GMutex log_lock;
+static gboolean json_format = FALSE;
+static char *scratch = NULL;
+static gsize scratch_size = 0;
+static GString *out = NULL;
+static GString *partial = NULL;
+static FILE *out_stream = NULL;
+static gint64 log_start;
+
+gboolean
+log_parse_categories (const char *list, guint *mask)
+{
+  char **names = g_strsplit (list, ",", -1);
+  gboolean ok = TRUE;
+  int i, c;
+
+  *mask = 0;
+  for (i = 0; names[i] != NULL && ok; i++)
+    {
+      char *name = g_strstrip (names[i]);
+
+      if (*name == '\0')
+        continue;
+      for (c = 0; c < N_LOG_CATEGORIES; c++)
+        if (strcmp (name, category_names[c]) == 0)
+          break;
+      if (c == N_LOG_CATEGORIES)
+        ok = FALSE;
+      else
+        *mask |= 1 << c;
+    }
+  g_strfreev (names);
+
+  return ok;
+}
+
+gboolean
+log_set_format (const char *format)
+{
+  if (strcmp (format, "text") == 0)
+    json_format = FALSE;
+  else if (strcmp (format, "jsonl") == 0)
+    json_format = TRUE;
+  else
+    return FALSE;
+
+  return TRUE;
+}
+
+static void
+flush_locked (gboolean sync)
+{
+  if (out == NULL || out_stream == NULL)
+    return;
+
+  if (out->len > 0)
+    fwrite (out->str, 1, out->len, out_stream);
+  g_string_truncate (out, 0);
+  if (sync)
+    fflush (out_stream);
+}
+
+void
+log_flush (void)
+{
+  g_mutex_lock (&log_lock);
+  flush_locked (TRUE);
+  g_mutex_unlock (&log_lock);
+}
+
+/* Format into the scratch buffer, growing it only when a message does
+ * not fit. */
+static char *
+format_message (const char *format, va_list args)
+{
+  va_list copy;
+  int len;
+
+  G_VA_COPY (copy, args);
+  len = g_vsnprintf (scratch, scratch_size, format, copy);
+  va_end (copy);
+
+  if (len >= 0 && (gsize) len >= scratch_size)
+    {
+      scratch_size = MAX ((gsize) len + 1, scratch_size * 2);
+      scratch = g_realloc (scratch, scratch_size);
+      g_vsnprintf (scratch, scratch_size, format, args);
+    }
+
+  return scratch;
+}
+
+/* Write one JSONL record for the LEN bytes of MSG, which must be
+ * followed by the newline that ends the message. */
+static void
+append_record (LogLevel level, LogCategory category, char *msg, gsize len)
+{
+  g_string_append_printf (out, "{\"ts\":%" G_GINT64_FORMAT
+                          ",\"level\":\"%s\",\"category\":\"%s\",\"msg\":",
+                          g_get_monotonic_time () - log_start,
+                          level == LOG_LEVEL_ERROR ? "error" : "debug",
+                          category_names[category]);
+  msg[len] = '\0';
+  json_append_string (out, msg);
+  msg[len] = '\n';
+  g_string_append (out, "}\n");
+}
+
+void
+log_write (FILE *stream, LogLevel level, LogCategory category,
+           const char *format, va_list args)
+{
+  char *msg;
+  gsize len;
+
+  g_mutex_lock (&log_lock);
+
+  if (out == NULL)
+    {
+      out = g_string_sized_new (LOG_BATCH + 256);
+      partial = g_string_new (NULL);
+      scratch_size = 256;
+      scratch = g_malloc (scratch_size);
+      log_start = g_get_monotonic_time ();
+      atexit (log_flush);
+    }
+  if (stream != out_stream)
+    {
+      flush_locked (TRUE);
+      out_stream = stream;
+    }
+
+  msg = format_message (format, args);
+  len = strlen (msg);
+
+  if (!json_format)
+    g_string_append_len (out, msg, len);
+  else if (len > 0 && msg[len - 1] == '\n')
+    {
+      /* Messages can be built from several calls; a record is written
+       * once the line is complete. */
+      if (partial->len > 0)
+        {
+          g_string_append_len (partial, msg, len);
+          append_record (level, category, partial->str, partial->len - 1);
+          g_string_truncate (partial, 0);
+        }
+      else
+        append_record (level, category, msg, len - 1);
+    }
+  else
+    g_string_append_len (partial, msg, len);
+
+  if (level == LOG_LEVEL_ERROR)
+    flush_locked (TRUE);
+  else if (stream == stdout || out->len >= LOG_BATCH)
+    flush_locked (FALSE);
+
+  g_mutex_unlock (&log_lock);
+}
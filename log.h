@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2026 pkg-config contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef PKG_CONFIG_LOG_H
+#define PKG_CONFIG_LOG_H
+
+#include <glib.h>
+#include <stdio.h>
+#include <stdarg.h>
+
+/* What a debug message is about, so that --debug-categories can pick */
+typedef enum
+{
+  LOG_GENERAL,
+  LOG_LOOKUP,   /* search path, finding .pc files, indexes */
+  LOG_PARSE,    /* reading .pc files, variables */
+  LOG_GRAPH,    /* Requires and other package relations */
+  LOG_FLAGS,    /* merging, resolving and rewriting flags */
+  N_LOG_CATEGORIES
+} LogCategory;
+
+typedef enum
+{
+  LOG_LEVEL_ERROR,
+  LOG_LEVEL_DEBUG
+} LogLevel;
+
+/* Set *MASK to the bits (1 << category) of the comma separated category
+ * names in LIST.  Returns FALSE if a name is unknown. */
+gboolean log_parse_categories (const char *list, guint *mask);
+
+/* Write messages as "text", the default, or "jsonl", one JSON object
+ * per line.  Returns FALSE if FORMAT is unknown. */
+gboolean log_set_format (const char *format);
+
+/* Format a message into the log buffer, which goes to STREAM in batches,
+ * when a message of LOG_LEVEL_ERROR is written and on exit.  Messages
+ * to stdout are passed on to stdio right away to keep their order with
+ * the normal output.  Can be called from any thread. */
+void log_write (FILE *stream, LogLevel level, LogCategory category,
+                const char *format, va_list args);
+
+/* Write out the log buffer. */
+void log_flush (void);
+
+#endif
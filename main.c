@@ -23,16 +23,31 @@
 
 #include "pkg.h"
 #include "parse.h"
+#include "pkgindex.h"
+#include "stats.h"
+#include "timings.h"
+#include "trace.h"
+#include "querylog.h"
+#include "memstats.h"
+#include "watch.h"
+#include "targets.h"
+#include "probes.h"
 
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 #include <stdio.h>
+#include <fcntl.h>
 
 #ifdef G_OS_WIN32
 #define STRICT
 #include <windows.h>
 #undef STRICT
+#include <io.h>
+#define NULL_DEVICE "NUL"
+#else
+#include <unistd.h>
+#define NULL_DEVICE "/dev/null"
 #endif
 
 char *pcsysrootdir = NULL;
@@ -42,7 +57,17 @@ static gboolean want_my_version = FALSE;
 static gboolean want_version = FALSE;
 static FlagType pkg_flags = 0;
 static gboolean want_list = FALSE;
+static gboolean want_static = FALSE;
 static gboolean want_static_lib_list = ENABLE_INDIRECT_DEPS;
+static gboolean want_resolved_libs = FALSE;
+static gboolean want_explain = FALSE;
+static char **overlinking_objects = NULL;
+static gboolean want_closure_stats = FALSE;
+static gboolean want_build_levels = FALSE;
+static int max_packages = 0;
+static int max_libs = 0;
+static int max_output_bytes = 0;
+static gboolean want_budgets = FALSE;
 static gboolean want_short_errors = FALSE;
 static gboolean want_uninstalled = FALSE;
 static char *variable_name = NULL;
@@ -50,7 +75,20 @@ static gboolean want_exists = FALSE;
 static gboolean want_provides = FALSE;
 static gboolean want_requires = FALSE;
 static gboolean want_requires_private = FALSE;
+static gboolean want_rdepends = FALSE;
+static char *which_provides = NULL;
+static gboolean want_include_requires = FALSE;
+static gboolean want_provides_requires_batch = FALSE;
 static gboolean want_validate = FALSE;
+static gboolean want_validate_all = FALSE;
+static gboolean want_validate_requires = FALSE;
+static char *timings_file_name = NULL;
+static gboolean want_stats_opt = FALSE;
+static gboolean want_watch = FALSE;
+static int benchmark_iterations = 0;
+static gboolean benchmark_reset = FALSE;
+static char *stats_file_name = NULL;
+static char *trace_file_name = NULL;
 static gboolean want_recursion = TRUE;
 static char *required_atleast_version = NULL;
 static char *required_exact_version = NULL;
@@ -63,58 +101,57 @@ static gboolean want_verbose_errors = FALSE;
 static gboolean want_stdout_errors = FALSE;
 static gboolean output_opt_set = FALSE;
 
+static guint debug_categories = ~0U;
+
+static FILE *
+log_stream (void)
+{
+  return want_stdout_errors ? stdout : stderr;
+}
+
 void
 debug_spew (const char *format, ...)
 {
   va_list args;
-  gchar *str;
-  FILE* stream;
 
   g_return_if_fail (format != NULL);
 
-  if (!want_debug_spew)
+  if (!want_debug_spew || !(debug_categories & (1 << LOG_GENERAL)))
     return;
 
   va_start (args, format);
-  str = g_strdup_vprintf (format, args);
+  log_write (log_stream (), LOG_LEVEL_DEBUG, LOG_GENERAL, format, args);
   va_end (args);
+}
 
-  if (want_stdout_errors)
-    stream = stdout;
-  else
-    stream = stderr;
+void
+debug_log (LogCategory category, const char *format, ...)
+{
+  va_list args;
 
-  fputs (str, stream);
-  fflush (stream);
+  g_return_if_fail (format != NULL);
 
-  g_free (str);
+  if (!want_debug_spew || !(debug_categories & (1 << category)))
+    return;
+
+  va_start (args, format);
+  log_write (log_stream (), LOG_LEVEL_DEBUG, category, format, args);
+  va_end (args);
 }
 
 void
 verbose_error (const char *format, ...)
 {
   va_list args;
-  gchar *str;
-  FILE* stream;
-  
+
   g_return_if_fail (format != NULL);
 
   if (!want_verbose_errors)
     return;
 
   va_start (args, format);
-  str = g_strdup_vprintf (format, args);
+  log_write (log_stream (), LOG_LEVEL_ERROR, LOG_GENERAL, format, args);
   va_end (args);
-
-  if (want_stdout_errors)
-    stream = stdout;
-  else
-    stream = stderr;
-  
-  fputs (str, stream);
-  fflush (stream);
-
-  g_free (str);
 }
 
 static gboolean
@@ -154,6 +191,97 @@ define_variable_cb (const char *opt, const char *arg, gpointer data,
   return TRUE;
 }
 
+#ifdef HAVE_SYS_SDT_H
+#ifdef HAVE_ON_EXIT
+static void
+exit_probe (int status, void *data)
+{
+  PROBE1 (exit, status);
+}
+#else
+static void
+exit_probe (void)
+{
+  PROBE1 (exit, -1);
+}
+#endif
+#endif
+
+static gboolean
+debug_categories_cb (const char *opt, const char *arg, gpointer data,
+                     GError **error)
+{
+  if (!log_parse_categories (arg, &debug_categories))
+    {
+      fprintf (stderr, "--debug-categories must be a list of general, "
+               "lookup, parse, graph and flags\n");
+      exit (1);
+    }
+
+  return TRUE;
+}
+
+static gboolean
+debug_format_cb (const char *opt, const char *arg, gpointer data,
+                 GError **error)
+{
+  if (!log_set_format (arg))
+    {
+      fprintf (stderr, "--debug-format argument must be text or jsonl\n");
+      exit (1);
+    }
+
+  return TRUE;
+}
+
+static gboolean
+timings_cb (const char *opt, const char *arg, gpointer data, GError **error)
+{
+  if (!timings_enable (arg, NULL))
+    {
+      fprintf (stderr, "--timings argument must be text or json\n");
+      exit (1);
+    }
+
+  return TRUE;
+}
+
+static gboolean
+target_cb (const char *opt, const char *arg, gpointer data, GError **error)
+{
+  if (!targets_add (arg))
+    {
+      fprintf (stderr, "--target argument must be NAME:KEY=VALUE,... with "
+               "a new NAME and keys sysroot, libdir or path\n");
+      exit (1);
+    }
+
+  return TRUE;
+}
+
+static gboolean
+memory_stats_cb (const char *opt, const char *arg, gpointer data,
+                 GError **error)
+{
+  int top = 10;
+
+  if (arg != NULL)
+    {
+      char *end;
+
+      top = strtol (arg, &end, 10);
+      if (*arg == '\0' || *end != '\0' || top <= 0)
+        {
+          fprintf (stderr, "--memory-stats argument must be a positive "
+                   "number\n");
+          exit (1);
+        }
+    }
+  memstats_enable (top);
+
+  return TRUE;
+}
+
 static gboolean
 output_opt_cb (const char *opt, const char *arg, gpointer data,
                GError **error)
@@ -168,6 +296,7 @@ output_opt_cb (const char *opt, const char *arg, gpointer data,
       /* multiple flag options (--cflags --libs-only-l) allowed */
       if (pkg_flags != 0 &&
           (strcmp (opt, "--libs") == 0 ||
+           strcmp (opt, "--libs-resolved") == 0 ||
            strcmp (opt, "--libs-only-l") == 0 ||
            strcmp (opt, "--libs-only-other") == 0 ||
            strcmp (opt, "--libs-only-L") == 0 ||
@@ -203,6 +332,11 @@ output_opt_cb (const char *opt, const char *arg, gpointer data,
     want_version = TRUE;
   else if (strcmp (opt, "--libs") == 0)
     pkg_flags |= LIBS_ANY;
+  else if (strcmp (opt, "--libs-resolved") == 0)
+    {
+      pkg_flags |= LIBS_ANY;
+      want_resolved_libs = TRUE;
+    }
   else if (strcmp (opt, "--libs-only-l") == 0)
     pkg_flags |= LIBS_l;
   else if (strcmp (opt, "--libs-only-other") == 0)
@@ -249,8 +383,22 @@ output_opt_cb (const char *opt, const char *arg, gpointer data,
     want_requires = TRUE;
   else if (strcmp (opt, "--print-requires-private") == 0)
     want_requires_private = TRUE;
+  else if (strcmp (opt, "--print-rdepends") == 0)
+    want_rdepends = TRUE;
+  else if (strcmp (opt, "--which-provides") == 0)
+    which_provides = g_strdup (arg);
+  else if (strcmp (opt, "--print-include-requires") == 0)
+    want_include_requires = TRUE;
+  else if (strcmp (opt, "--print-provides-requires") == 0)
+    want_provides_requires_batch = TRUE;
   else if (strcmp (opt, "--validate") == 0)
     want_validate = TRUE;
+  else if (strcmp (opt, "--validate-all") == 0)
+    want_validate_all = TRUE;
+  else if (strcmp (opt, "--closure-stats") == 0)
+    want_closure_stats = TRUE;
+  else if (strcmp (opt, "--print-build-levels") == 0)
+    want_build_levels = TRUE;
   else
     return FALSE;
 
@@ -259,11 +407,17 @@ output_opt_cb (const char *opt, const char *arg, gpointer data,
 }
 
 static gboolean
-pkg_uninstalled (Package *pkg)
+recursive_pkg_uninstalled (Package *pkg, GHashTable *visited)
 {
-  /* See if > 0 pkgs were uninstalled */
   GList *tmp;
 
+  /* Packages reached through several paths are only checked once,
+   * which keeps diamond shaped graphs linear */
+  if (g_hash_table_lookup_extended (visited, pkg->key, NULL, NULL))
+    return FALSE;
+  g_hash_table_add (visited, pkg->key);
+  stats_add (STAT_GRAPH_VISITS, 1);
+
   if (pkg->uninstalled)
     return TRUE;
 
@@ -272,7 +426,7 @@ pkg_uninstalled (Package *pkg)
     {
       Package *pkg = tmp->data;
 
-      if (pkg_uninstalled (pkg))
+      if (recursive_pkg_uninstalled (pkg, visited))
         return TRUE;
 
       tmp = g_list_next (tmp);
@@ -281,6 +435,143 @@ pkg_uninstalled (Package *pkg)
   return FALSE;
 }
 
+static gboolean
+pkg_uninstalled (Package *pkg)
+{
+  /* See if > 0 pkgs were uninstalled */
+  GHashTable *visited = g_hash_table_new (g_str_hash, g_str_equal);
+  gboolean retval = recursive_pkg_uninstalled (pkg, visited);
+
+  g_hash_table_destroy (visited);
+  return retval;
+}
+
+static void
+print_provides (Package *pkg, const char *prefix)
+{
+  char *key;
+  key = pkg->key;
+  while (*key == '/')
+    key++;
+  if (strlen(key) > 0)
+    printf ("%s%s = %s\n", prefix, key, pkg->version);
+}
+
+static void
+print_required_version (const char *prefix, RequiredVersion *req)
+{
+  if (req->comparison == ALWAYS_MATCH)
+    printf ("%s%s\n", prefix, req->name);
+  else
+    printf ("%s%s %s %s\n", prefix, req->name,
+            comparison_to_str (req->comparison), req->version);
+}
+
+/* Print the Requires of PKG, each line preceded by REQUIRES_PREFIX, and
+ * the Requires.private not already in Requires, each line preceded by
+ * PRIVATE_PREFIX.  A NULL prefix skips that part. */
+static void
+print_requires (Package *pkg, const char *requires_prefix,
+                const char *private_prefix)
+{
+  GList *reqtmp;
+  GHashTable *seen = g_hash_table_new (g_str_hash, g_str_equal);
+
+  /* Process Requires. */
+  for (reqtmp = pkg->requires_entries;
+       reqtmp != NULL; reqtmp = g_list_next (reqtmp))
+    {
+      RequiredVersion *req = reqtmp->data;
+      g_hash_table_add (seen, req->name);
+      if (requires_prefix != NULL)
+        print_required_version (requires_prefix, req);
+    }
+
+  /* Enhance Requires with versioned Requires.private. */
+  if (requires_prefix != NULL)
+  for (reqtmp = pkg->requires_private_entries;
+       reqtmp != NULL; reqtmp = g_list_next (reqtmp))
+    {
+      RequiredVersion *req = reqtmp->data;
+      if (req->comparison == ALWAYS_MATCH)
+        continue;
+      if (g_hash_table_lookup (seen, req->name) == NULL)
+        continue;
+      print_required_version (requires_prefix, req);
+    }
+
+  /* Print the rest of Requires.private. */
+  if (private_prefix != NULL)
+  for (reqtmp = pkg->requires_private_entries;
+       reqtmp != NULL; reqtmp = g_list_next (reqtmp))
+    {
+      RequiredVersion *req = reqtmp->data;
+      if (g_hash_table_lookup (seen, req->name) != NULL)
+        continue;
+      print_required_version (private_prefix, req);
+    }
+  g_hash_table_destroy (seen);
+}
+
+/* Print the provides and requires of each of the N .pc files PATHS as
+ * "FILE\tKIND\tVALUE" lines, KIND being provides, requires or
+ * requires.private, with the same values as --print-provides,
+ * --print-requires and --print-requires-private.  The files are parsed
+ * in parallel and their dependencies are not loaded.
+ */
+static gboolean
+print_provides_requires_batch (char **paths, guint n)
+{
+  char **keys;
+  Package **pkgs;
+  gboolean success = TRUE;
+  guint i;
+
+  keys = g_new0 (char *, n + 1);
+  for (i = 0; i < n; i++)
+    {
+      keys[i] = g_path_get_basename (paths[i]);
+      if (g_str_has_suffix (keys[i], ".pc"))
+        keys[i][strlen (keys[i]) - 3] = '\0';
+    }
+
+  pkgs = parse_package_files (keys, paths, n, NULL);
+
+  for (i = 0; i < n; i++)
+    {
+      Package *pkg = pkgs[i];
+      char *prefix;
+      char *private_prefix;
+
+      if (pkg == NULL)
+        {
+          success = FALSE;
+          continue;
+        }
+      if (pkg->version == NULL)
+        {
+          verbose_error ("Package '%s' has no Version: field\n", pkg->key);
+          success = FALSE;
+          continue;
+        }
+
+      prefix = g_strdup_printf ("%s\tprovides\t", paths[i]);
+      print_provides (pkg, prefix);
+      g_free (prefix);
+
+      prefix = g_strdup_printf ("%s\trequires\t", paths[i]);
+      private_prefix = g_strdup_printf ("%s\trequires.private\t", paths[i]);
+      print_requires (pkg, prefix, private_prefix);
+      g_free (private_prefix);
+      g_free (prefix);
+    }
+
+  g_free (pkgs);
+  g_strfreev (keys);
+
+  return success;
+}
+
 void
 print_list_data (gpointer data,
                  gpointer user_data)
@@ -317,7 +608,7 @@ init_pc_path (void)
 }
 
 static gboolean
-process_package_args (const char *cmdline, GList **packages, FILE *log)
+process_package_args (const char *cmdline, GList **packages)
 {
   gboolean success = TRUE;
   GList *reqs;
@@ -360,15 +651,8 @@ process_package_args (const char *cmdline, GList **packages, FILE *log)
       else
         req = get_package (ver->name);
 
-      if (log != NULL)
-        {
-          if (req == NULL)
-            fprintf (log, "%s NOT-FOUND\n", ver->name);
-          else
-            fprintf (log, "%s %s %s\n", ver->name,
-                     comparison_to_str (ver->comparison),
-                     (ver->version == NULL) ? "(null)" : ver->version);
-        }
+      querylog_module (ver->name, comparison_to_str (ver->comparison),
+                       ver->version, req != NULL);
 
       if (req == NULL)
         {
@@ -410,8 +694,17 @@ static const GOptionEntry options_table[] = {
     "require given version of pkg-config", "VERSION" },
   { "libs", 0, G_OPTION_FLAG_NO_ARG, G_OPTION_ARG_CALLBACK, &output_opt_cb,
     "output all linker flags", NULL },
-  { "static", 0, 0, G_OPTION_ARG_NONE, &want_static_lib_list,
+  { "libs-resolved", 0, G_OPTION_FLAG_NO_ARG, G_OPTION_ARG_CALLBACK,
+    &output_opt_cb, "output linker flags with -l flags resolved to library "
+    "paths", NULL },
+  { "static", 0, 0, G_OPTION_ARG_NONE, &want_static,
     "output linker flags for static linking", NULL },
+  { "explain", 0, 0, G_OPTION_ARG_NONE, &want_explain,
+    "annotate each flag with the package and dependencies that introduced "
+    "it", NULL },
+  { "check-overlinking", 0, 0, G_OPTION_ARG_FILENAME_ARRAY,
+    &overlinking_objects, "report libraries that provide no symbol needed "
+    "by the object or binary FILE (may be repeated)", "FILE" },
   { "short-errors", 0, 0, G_OPTION_ARG_NONE, &want_short_errors,
     "print short errors", NULL },
   { "libs-only-l", 0, G_OPTION_FLAG_NO_ARG, G_OPTION_ARG_CALLBACK,
@@ -448,6 +741,12 @@ static const GOptionEntry options_table[] = {
     &output_opt_cb, "list all known packages", NULL },
   { "debug", 0, 0, G_OPTION_ARG_NONE, &want_debug_spew,
     "show verbose debug information", NULL },
+  { "debug-categories", 0, 0, G_OPTION_ARG_CALLBACK, &debug_categories_cb,
+    "only show --debug information of the comma separated categories: "
+    "general, lookup, parse, graph and flags", "LIST" },
+  { "debug-format", 0, 0, G_OPTION_ARG_CALLBACK, &debug_format_cb,
+    "write --debug information and errors as text (default) or jsonl",
+    "FORMAT" },
   { "print-errors", 0, 0, G_OPTION_ARG_NONE, &want_verbose_errors,
     "show verbose information about missing or conflicting packages "
     "(default unless --exists or --atleast/exact/max-version given on the "
@@ -464,8 +763,38 @@ static const GOptionEntry options_table[] = {
   { "print-requires-private", 0, G_OPTION_FLAG_NO_ARG, G_OPTION_ARG_CALLBACK,
     &output_opt_cb, "print which packages the package requires for static "
     "linking", NULL },
+  { "print-provides-requires", 0, G_OPTION_FLAG_NO_ARG, G_OPTION_ARG_CALLBACK,
+    &output_opt_cb, "print what each .pc file given as argument or on "
+    "standard input provides and requires, without loading dependencies",
+    NULL },
+  { "print-rdepends", 0, G_OPTION_FLAG_NO_ARG, G_OPTION_ARG_CALLBACK,
+    &output_opt_cb, "print which packages in the search path require the "
+    "package, directly or indirectly", NULL },
+  { "which-provides", 0, 0, G_OPTION_ARG_CALLBACK, &output_opt_cb,
+    "print which package provides the header or library NAME", "NAME" },
+  { "print-include-requires", 0, G_OPTION_FLAG_NO_ARG, G_OPTION_ARG_CALLBACK,
+    &output_opt_cb, "print which packages provide the headers that the "
+    "package's headers include", NULL },
   { "validate", 0, G_OPTION_FLAG_NO_ARG, G_OPTION_ARG_CALLBACK,
     &output_opt_cb, "validate a package's .pc file", NULL },
+  { "validate-all", 0, G_OPTION_FLAG_NO_ARG, G_OPTION_ARG_CALLBACK,
+    &output_opt_cb, "validate every .pc file in the directories given as "
+    "arguments, or in the search path, and report all problems", NULL },
+  { "validate-requires", 0, 0, G_OPTION_ARG_NONE, &want_validate_requires,
+    "with --validate-all, also check that Requires and Requires.private "
+    "can be satisfied", NULL },
+  { "closure-stats", 0, G_OPTION_FLAG_NO_ARG, G_OPTION_ARG_CALLBACK,
+    &output_opt_cb, "print statistics about the dependency closure", NULL },
+  { "print-build-levels", 0, G_OPTION_FLAG_NO_ARG, G_OPTION_ARG_CALLBACK,
+    &output_opt_cb, "print the dependency closure in levels that can be "
+    "built in parallel, and the length of the critical path", NULL },
+  { "max-packages", 0, 0, G_OPTION_ARG_INT, &max_packages,
+    "fail if the dependency closure has more than N packages", "N" },
+  { "max-libs", 0, 0, G_OPTION_ARG_INT, &max_libs,
+    "fail if the closure has more than N -l flags", "N" },
+  { "max-output-bytes", 0, 0, G_OPTION_ARG_INT, &max_output_bytes,
+    "fail if the closure's --cflags and --libs take more than N bytes",
+    "N" },
   { "disable-recursion", 0, G_OPTION_FLAG_REVERSE, G_OPTION_ARG_NONE,
     &want_recursion, "disable loading of dependencies", NULL },
   { "define-prefix", 0, 0, G_OPTION_ARG_NONE, &define_prefix,
@@ -478,6 +807,34 @@ static const GOptionEntry options_table[] = {
   { "prefix-variable", 0, 0, G_OPTION_ARG_STRING, &prefix_variable,
     "set the name of the variable that pkg-config automatically sets",
     "PREFIX" },
+  { "include-farm", 0, 0, G_OPTION_ARG_FILENAME, &include_farm_dir,
+    "merge -I directories into a single include farm directory under DIR",
+    "DIR" },
+  { "timings", 0, G_OPTION_FLAG_OPTIONAL_ARG, G_OPTION_ARG_CALLBACK,
+    &timings_cb, "report the time spent in each phase on exit, as text "
+    "(default) or json", "FORMAT" },
+  { "timings-file", 0, 0, G_OPTION_ARG_FILENAME, &timings_file_name,
+    "append the --timings report to FILE instead of printing it", "FILE" },
+  { "stats", 0, 0, G_OPTION_ARG_NONE, &want_stats_opt,
+    "print counters of the operations done as JSON on exit", NULL },
+  { "stats-file", 0, 0, G_OPTION_ARG_FILENAME, &stats_file_name,
+    "append the --stats counters to FILE instead of printing them", "FILE" },
+  { "target", 0, 0, G_OPTION_ARG_CALLBACK, &target_cb,
+    "resolve the query for each target NAME, with the given sysroot, "
+    "libdir and path, and print the results as JSON", "NAME:SETTINGS" },
+  { "watch", 0, 0, G_OPTION_ARG_NONE, &want_watch,
+    "print the output again each time it changes with the .pc files, "
+    "until interrupted", NULL },
+  { "memory-stats", 0, G_OPTION_FLAG_OPTIONAL_ARG, G_OPTION_ARG_CALLBACK,
+    &memory_stats_cb, "report the memory held by the N biggest packages "
+    "(default 10) and in total on exit", "N" },
+  { "benchmark", 0, 0, G_OPTION_ARG_INT, &benchmark_iterations,
+    "run the query N times and report its latency and allocations", "N" },
+  { "benchmark-reset", 0, 0, G_OPTION_ARG_NONE, &benchmark_reset,
+    "forget the loaded packages before each --benchmark run", NULL },
+  { "trace", 0, 0, G_OPTION_ARG_FILENAME, &trace_file_name,
+    "write a trace of package lookups and loading to FILE, in the Chrome "
+    "trace event format", "FILE" },
 #ifdef G_OS_WIN32
   { "msvc-syntax", 0, 0, G_OPTION_ARG_NONE, &msvc_syntax,
     "output -l and -L flags for the Microsoft compiler (cl)", NULL },
@@ -485,18 +842,283 @@ static const GOptionEntry options_table[] = {
   { NULL, 0, 0, 0, NULL, NULL, NULL }
 };
 
+/* Print what the output options ask for about PACKAGES, the packages
+ * given on the command line.  Returns the exit status. */
+static int
+print_packages (GList *packages)
+{
+  gboolean need_newline;
+
+  /* If the user just wants to check package existence or validate its .pc
+   * file, we're all done. */
+  if (want_exists || want_validate)
+    return 0;
+
+  if (want_variable_list)
+    {
+      GList *tmp;
+      tmp = packages;
+      while (tmp != NULL)
+        {
+          Package *pkg = tmp->data;
+          if (pkg->vars != NULL)
+            {
+              /* Sort variables for consistent output */
+              GList *keys = g_hash_table_get_keys (pkg->vars);
+              keys = g_list_sort (keys, (GCompareFunc)g_strcmp0);
+              g_list_foreach (keys, print_list_data, NULL);
+              g_list_free (keys);
+            }
+          tmp = g_list_next (tmp);
+          if (tmp) printf ("\n");
+        }
+      need_newline = FALSE;
+    }
+
+  if (want_uninstalled)
+    {
+      /* See if > 0 pkgs (including dependencies recursively) were uninstalled */
+      GList *tmp;
+      tmp = packages;
+      while (tmp != NULL)
+        {
+          Package *pkg = tmp->data;
+
+          if (pkg_uninstalled (pkg))
+            return 0;
+
+          tmp = g_list_next (tmp);
+        }
+
+      return 1;
+    }
+
+  if (want_version)
+    {
+      GList *tmp;
+      tmp = packages;
+      while (tmp != NULL)
+        {
+          Package *pkg = tmp->data;
+
+          printf ("%s\n", pkg->version);
+
+          tmp = g_list_next (tmp);
+        }
+    }
+
+ if (want_provides)
+   {
+     GList *tmp;
+     tmp = packages;
+     while (tmp != NULL)
+       {
+         print_provides (tmp->data, "");
+         tmp = g_list_next (tmp);
+       }
+   }
+
+  if (want_requires || want_requires_private)
+    {
+      GList *pkgtmp;
+      for (pkgtmp = packages; pkgtmp != NULL; pkgtmp = g_list_next (pkgtmp))
+        print_requires (pkgtmp->data, want_requires ? "" : NULL,
+                        want_requires_private ? "" : NULL);
+    }
+
+  if (want_include_requires)
+    {
+      GList *pkgtmp;
+      for (pkgtmp = packages; pkgtmp != NULL; pkgtmp = g_list_next (pkgtmp))
+        print_include_requires (pkgtmp->data);
+    }
+
+  /* Print all flags; then print a newline at the end. */
+  need_newline = FALSE;
+
+  if (variable_name)
+    {
+      char *str = packages_get_var (packages, variable_name);
+      printf ("%s", str);
+      g_free (str);
+      need_newline = TRUE;
+    }
+
+  if (pkg_flags != 0 && want_explain)
+    {
+      char *str = packages_explain_flags (packages, pkg_flags);
+      printf ("%s", str);
+      g_free (str);
+    }
+  else if (pkg_flags != 0)
+    {
+      char *str = packages_get_flags (packages, pkg_flags);
+      printf ("%s", str);
+      g_free (str);
+      need_newline = TRUE;
+    }
+
+  if (need_newline)
+    printf ("\n");
+
+  if (overlinking_objects != NULL &&
+      !packages_check_overlinking (packages, overlinking_objects))
+    return 1;
+
+  if (want_build_levels)
+    packages_print_build_levels (packages);
+
+  if ((want_closure_stats || want_budgets) &&
+      !packages_closure_stats (packages, want_closure_stats, max_packages,
+                               max_libs, max_output_bytes))
+    return 1;
+
+  return 0;
+}
+
+/* Look up the packages on the command line and print the output */
+static int
+run_query (const char *cmdline)
+{
+  GList *packages = NULL;
+  int status;
+
+  /* find and parse each of the packages specified */
+  if (!process_package_args (cmdline, &packages))
+    return 1;
+
+  timings_push (PHASE_OUTPUT);
+  status = print_packages (packages);
+  timings_pop ();
+  g_list_free (packages);
+
+  return status;
+}
+
+static int
+double_cmp (const void *a, const void *b)
+{
+  double x = *(const double *) a;
+  double y = *(const double *) b;
+
+  return x < y ? -1 : x > y;
+}
+
+/* Run the query benchmark_iterations times in this process, printing
+ * the output of the last one only, and report the latencies and
+ * allocations on stderr. */
+static int
+run_benchmark (const char *cmdline)
+{
+  double *times = g_new (double, benchmark_iterations);
+  gsize allocs_before = 0, bytes_before = 0;
+  gsize allocs_after, bytes_after;
+  gboolean counted;
+  int saved_stdout = -1;
+  int status = 0;
+  int i;
+
+  counted = stats_get_allocations (&allocs_before, &bytes_before);
+
+  for (i = 0; i < benchmark_iterations; i++)
+    {
+      gint64 start;
+
+      if (benchmark_reset && i > 0)
+        {
+          package_reset ();
+          package_init (FALSE);
+        }
+
+      /* only the last iteration's output is wanted */
+      fflush (stdout);
+      if (i == 0 && benchmark_iterations > 1)
+        {
+          int null_fd = open (NULL_DEVICE, O_WRONLY);
+
+          saved_stdout = dup (fileno (stdout));
+          dup2 (null_fd, fileno (stdout));
+          close (null_fd);
+        }
+      else if (i == benchmark_iterations - 1 && saved_stdout >= 0)
+        {
+          dup2 (saved_stdout, fileno (stdout));
+          close (saved_stdout);
+        }
+
+      start = g_get_monotonic_time ();
+      status = run_query (cmdline);
+      times[i] = (g_get_monotonic_time () - start) / 1000.0;
+    }
+
+  qsort (times, benchmark_iterations, sizeof (double), double_cmp);
+  fflush (stdout);
+  fprintf (stderr, "Benchmark of %d iterations (%s): min %.3f ms, "
+           "median %.3f ms, p99 %.3f ms\n",
+           benchmark_iterations, benchmark_reset ? "cold" : "warm",
+           times[0], times[benchmark_iterations / 2],
+           times[(benchmark_iterations * 99 + 99) / 100 - 1]);
+  if (counted && stats_get_allocations (&allocs_after, &bytes_after))
+    fprintf (stderr, "Allocations per iteration: %.1f (%.0f bytes)\n",
+             (double) (allocs_after - allocs_before) / benchmark_iterations,
+             (double) (bytes_after - bytes_before) / benchmark_iterations);
+  else
+    fprintf (stderr, "Allocations per iteration: not counted with this "
+             "GLib\n");
+
+  g_free (times);
+
+  return status;
+}
+
 int
 main (int argc, char **argv)
 {
   GString *str;
-  GList *packages = NULL;
   char *search_path;
   char *pcbuilddir;
-  gboolean need_newline;
-  FILE *log = NULL;
+  int status;
   GError *error = NULL;
   GOptionContext *opt_context;
 
+  stats_init (argc, argv);
+  targets_init (argc, argv);
+#ifdef HAVE_SYS_SDT_H
+#ifdef HAVE_ON_EXIT
+  on_exit (exit_probe, NULL);
+#else
+  atexit (exit_probe);
+#endif
+#endif
+  if (getenv ("PKG_CONFIG_STATS"))
+    stats_enable (getenv ("PKG_CONFIG_STATS_FILE"));
+  if (getenv ("PKG_CONFIG_LOG") != NULL)
+    querylog_open (getenv ("PKG_CONFIG_LOG"), argc, argv);
+
+  timings_start ();
+  if (getenv ("PKG_CONFIG_TIMINGS") &&
+      !timings_enable (getenv ("PKG_CONFIG_TIMINGS"),
+                       getenv ("PKG_CONFIG_TIMINGS_FILE")))
+    {
+      fprintf (stderr, "PKG_CONFIG_TIMINGS must be text or json\n");
+      exit (1);
+    }
+
+  if (getenv ("PKG_CONFIG_DEBUG_CATEGORIES") &&
+      !log_parse_categories (getenv ("PKG_CONFIG_DEBUG_CATEGORIES"),
+                             &debug_categories))
+    {
+      fprintf (stderr, "PKG_CONFIG_DEBUG_CATEGORIES must be a list of "
+               "general, lookup, parse, graph and flags\n");
+      exit (1);
+    }
+  if (getenv ("PKG_CONFIG_DEBUG_FORMAT") &&
+      !log_set_format (getenv ("PKG_CONFIG_DEBUG_FORMAT")))
+    {
+      fprintf (stderr, "PKG_CONFIG_DEBUG_FORMAT must be text or jsonl\n");
+      exit (1);
+    }
+
   /* This is here so that we get debug spew from the start,
    * during arg parsing
    */
@@ -560,6 +1182,7 @@ main (int argc, char **argv)
       debug_spew ("disabling auto-preference for uninstalled packages\n");
       disable_uninstalled = TRUE;
     }
+  timings_mark (PHASE_SEARCH_PATH);
 
   /* Parse options */
   opt_context = g_option_context_new (NULL);
@@ -569,9 +1192,41 @@ main (int argc, char **argv)
       fprintf (stderr, "%s\n", error->message);
       return 1;
     }
+  if (timings_file_name != NULL)
+    timings_enable (NULL, timings_file_name);
+  if (want_stats_opt || stats_file_name != NULL)
+    stats_enable (stats_file_name);
+  if (trace_file_name != NULL && !trace_open (trace_file_name))
+    {
+      fprintf (stderr, "Cannot open trace file: %s\n", trace_file_name);
+      return 1;
+    }
+  timings_mark (PHASE_OPTIONS);
+
+  if (benchmark_iterations < 0)
+    {
+      fprintf (stderr, "--benchmark argument must not be negative\n");
+      return 1;
+    }
+  if (want_watch && benchmark_iterations > 0)
+    {
+      fprintf (stderr, "--watch cannot be used with --benchmark\n");
+      return 1;
+    }
+  if (want_watch && targets_wanted ())
+    {
+      fprintf (stderr, "--watch cannot be used with --target\n");
+      return 1;
+    }
+  /* Each target is resolved by another pkg-config, with the same
+   * options */
+  if (targets_wanted ())
+    return targets_run ();
+
+  want_budgets = max_packages > 0 || max_libs > 0 || max_output_bytes > 0;
 
   /* If no output option was set, then --exists is the default. */
-  if (!output_opt_set)
+  if (!output_opt_set && overlinking_objects == NULL && !want_budgets)
     {
       debug_spew ("no output option set, defaulting to --exists\n");
       want_exists = TRUE;
@@ -611,11 +1266,17 @@ main (int argc, char **argv)
   else
     debug_spew ("Error printing disabled\n");
 
+  if (want_static)
+    want_static_lib_list = TRUE;
+
   if (want_static_lib_list)
     enable_private_libs();
   else
     disable_private_libs();
 
+  if (want_resolved_libs)
+    enable_resolved_libs(want_static);
+
   /*
    * Cflags-only dependencies, such as those resulting from #include
    * directives, should be listed on behalf of Requires.private rather
@@ -634,7 +1295,8 @@ main (int argc, char **argv)
    * distro's packaging system, and therefore cannot be enabled
    * by default.  Specifically, the packaging system needs to use
    * an additional dependency generator, known as cpp.req,
-   * which tracks #include directives in the header files.
+   * which tracks #include directives in the header files;
+   * --print-include-requires implements such a generator.
    */
 #define TOLERATE_MISSING_REQUIRES_PRIVATE FALSE
 
@@ -643,11 +1305,15 @@ main (int argc, char **argv)
     disable_requires ();
   /* No need to load Requires; probably in --validate mode. */
   else if (pkg_flags == 0 && !want_exists &&
-           !want_requires && !want_requires_private)
+           !want_requires && !want_requires_private &&
+           overlinking_objects == NULL && !want_closure_stats &&
+           !want_build_levels && !want_budgets)
     disable_requires ();
   /* Need to enable Requires.private unconditinally. */
-  else if (want_requires_private ||
-           (want_static_lib_list && (pkg_flags & LIBS_ANY)))
+  else if (want_requires_private || want_closure_stats ||
+           want_build_levels || want_budgets ||
+           (want_static_lib_list &&
+            ((pkg_flags & LIBS_ANY) || overlinking_objects != NULL)))
     enable_requires_private (FALSE);
   /* Conservative --exists needs to check for Requires.private. */
   else if (want_exists && !TOLERATE_MISSING_REQUIRES_PRIVATE)
@@ -656,8 +1322,9 @@ main (int argc, char **argv)
   else if (pkg_flags & CFLAGS_ANY)
     enable_requires_private (TOLERATE_MISSING_REQUIRES_PRIVATE);
 
-  /* Allow errors in .pc files when listing all. */
-  if (want_list)
+  /* Allow errors in .pc files when listing or indexing all. */
+  if (want_list || want_rdepends || which_provides || want_include_requires ||
+      want_provides_requires_batch)
     parse_strict = FALSE;
 
   if (want_my_version)
@@ -682,196 +1349,113 @@ main (int argc, char **argv)
       return 0;
     }
 
-  /* Collect packages from remaining args */
-  str = g_string_new ("");
-  while (argc > 1)
-    {
-      argc--;
-      argv++;
-
-      g_string_append (str, *argv);
-      g_string_append (str, " ");
-    }
-
-  g_option_context_free (opt_context);
+  if (which_provides)
+    return print_which_provides (which_provides) ? 0 : 1;
 
-  g_strstrip (str->str);
-
-  if (getenv("PKG_CONFIG_LOG") != NULL)
+  /* The remaining arguments are directories; every .pc file in them is
+   * parsed on its own and all problems are reported. */
+  if (want_validate_all)
     {
-      log = fopen (getenv ("PKG_CONFIG_LOG"), "a");
-      if (log == NULL)
-	{
-	  fprintf (stderr, "Cannot open log file: %s\n",
-		   getenv ("PKG_CONFIG_LOG"));
-	  exit (1);
-	}
-    }
-
-  /* find and parse each of the packages specified */
-  if (!process_package_args (str->str, &packages, log))
-    return 1;
-
-  if (log != NULL)
-    fclose (log);
+      GList *dirs = NULL;
+      gboolean success;
+      int i;
 
-  g_string_free (str, TRUE);
+      for (i = 1; i < argc; i++)
+        dirs = g_list_append (dirs, argv[i]);
+      success = validate_all (dirs, want_validate_requires);
+      g_list_free (dirs);
 
-  /* If the user just wants to check package existence or validate its .pc
-   * file, we're all done. */
-  if (want_exists || want_validate)
-    return 0;
+      return success ? 0 : 1;
+    }
 
-  if (want_variable_list)
+  /* The .pc files are given by path, one per argument or line of
+   * standard input, and parsed on their own. */
+  if (want_provides_requires_batch)
     {
-      GList *tmp;
-      tmp = packages;
-      while (tmp != NULL)
+      GPtrArray *paths = g_ptr_array_new_with_free_func (g_free);
+      gboolean success;
+      int i;
+
+      for (i = 1; i < argc; i++)
+        g_ptr_array_add (paths, g_strdup (argv[i]));
+      if (argc < 2)
         {
-          Package *pkg = tmp->data;
-          if (pkg->vars != NULL)
+          GString *line = g_string_new (NULL);
+          int c;
+
+          do
             {
-              /* Sort variables for consistent output */
-              GList *keys = g_hash_table_get_keys (pkg->vars);
-              keys = g_list_sort (keys, (GCompareFunc)g_strcmp0);
-              g_list_foreach (keys, print_list_data, NULL);
-              g_list_free (keys);
+              c = getc (stdin);
+              if (c != EOF && c != '\n')
+                g_string_append_c (line, c);
+              else
+                {
+                  g_strchomp (line->str);
+                  if (*line->str != '\0')
+                    g_ptr_array_add (paths, g_strdup (line->str));
+                  g_string_truncate (line, 0);
+                }
             }
-          tmp = g_list_next (tmp);
-          if (tmp) printf ("\n");
+          while (c != EOF);
+          g_string_free (line, TRUE);
         }
-      need_newline = FALSE;
-    }
-
-  if (want_uninstalled)
-    {
-      /* See if > 0 pkgs (including dependencies recursively) were uninstalled */
-      GList *tmp;
-      tmp = packages;
-      while (tmp != NULL)
-        {
-          Package *pkg = tmp->data;
-
-          if (pkg_uninstalled (pkg))
-            return 0;
 
-          tmp = g_list_next (tmp);
-        }
+      success = print_provides_requires_batch ((char **) paths->pdata,
+                                               paths->len);
+      g_ptr_array_free (paths, TRUE);
 
-      return 1;
+      return success ? 0 : 1;
     }
 
-  if (want_version)
+  /* Collect packages from remaining args */
+  str = g_string_new ("");
+  while (argc > 1)
     {
-      GList *tmp;
-      tmp = packages;
-      while (tmp != NULL)
-        {
-          Package *pkg = tmp->data;
-
-          printf ("%s\n", pkg->version);
+      argc--;
+      argv++;
 
-          tmp = g_list_next (tmp);
-        }
+      g_string_append (str, *argv);
+      g_string_append (str, " ");
     }
 
- if (want_provides)
-   {
-     GList *tmp;
-     tmp = packages;
-     while (tmp != NULL)
-       {
-         Package *pkg = tmp->data;
-         char *key;
-         key = pkg->key;
-         while (*key == '/')
-           key++;
-         if (strlen(key) > 0)
-           printf ("%s = %s\n", key, pkg->version);
-         tmp = g_list_next (tmp);
-       }
-   }
+  g_option_context_free (opt_context);
 
-  if (want_requires || want_requires_private)
+  g_strstrip (str->str);
+
+  /* The reverse dependencies come from an index of all .pc files, so the
+   * packages don't need to be loaded. */
+  if (want_rdepends)
     {
-      GList *pkgtmp;
-      for (pkgtmp = packages; pkgtmp != NULL; pkgtmp = g_list_next (pkgtmp))
-        {
-          Package *pkg = pkgtmp->data;
-          GList *reqtmp;
-          GHashTable *seen = g_hash_table_new (g_str_hash, g_str_equal);
+      GList *reqs = parse_module_list (NULL, str->str,
+                                       "(command line arguments)");
+      gboolean success = TRUE;
 
-          /* Process Requires. */
-          for (reqtmp = pkg->requires_entries;
-               reqtmp != NULL; reqtmp = g_list_next (reqtmp))
-            {
-              RequiredVersion *req = reqtmp->data;
-              g_hash_table_add (seen, req->name);
-              if (!want_requires)
-                continue;
-              if (req->comparison == ALWAYS_MATCH)
-                printf ("%s\n", req->name);
-              else
-                printf ("%s %s %s\n", req->name,
-                  comparison_to_str (req->comparison),
-                  req->version);
-            }
+      if (reqs == NULL)
+        {
+          fprintf (stderr, "Must specify package names on the command line\n");
+          fflush (stderr);
+          return 1;
+        }
 
-          /* Enhance Requires with versioned Requires.private. */
-          if (want_requires)
-          for (reqtmp = pkg->requires_private_entries;
-               reqtmp != NULL; reqtmp = g_list_next (reqtmp))
-            {
-              RequiredVersion *req = reqtmp->data;
-              if (req->comparison == ALWAYS_MATCH)
-                continue;
-              if (g_hash_table_lookup (seen, req->name) == NULL)
-                continue;
-              printf ("%s %s %s\n", req->name,
-                comparison_to_str (req->comparison),
-                req->version);
-            }
+      for (; reqs != NULL; reqs = g_list_next (reqs))
+        {
+          RequiredVersion *ver = reqs->data;
 
-          /* Print the rest of Requires.private. */
-          if (want_requires_private)
-          for (reqtmp = pkg->requires_private_entries;
-               reqtmp != NULL; reqtmp = g_list_next (reqtmp))
-            {
-              RequiredVersion *req = reqtmp->data;
-              if (g_hash_table_lookup (seen, req->name) != NULL)
-                continue;
-              if (req->comparison == ALWAYS_MATCH)
-                printf ("%s\n", req->name);
-              else
-                printf ("%s %s %s\n", req->name,
-                  comparison_to_str (req->comparison),
-                  req->version);
-            }
-          g_hash_table_destroy (seen);
+          if (!print_rdepends (ver->name))
+            success = FALSE;
         }
-    }
-  
-  /* Print all flags; then print a newline at the end. */
-  need_newline = FALSE;
 
-  if (variable_name)
-    {
-      char *str = packages_get_var (packages, variable_name);
-      printf ("%s", str);
-      g_free (str);
-      need_newline = TRUE;
+      return success ? 0 : 1;
     }
 
-  if (pkg_flags != 0)
-    {
-      char *str = packages_get_flags (packages, pkg_flags);
-      printf ("%s", str);
-      g_free (str);
-      need_newline = TRUE;
-    }
+  if (want_watch)
+    status = watch_query (run_query, str->str);
+  else if (benchmark_iterations > 0)
+    status = run_benchmark (str->str);
+  else
+    status = run_query (str->str);
 
-  if (need_newline)
-    printf ("\n");
+  g_string_free (str, TRUE);
 
-  return 0;
+  return status;
 }
@@ -0,0 +1,251 @@
+/*
+ * Copyright (C) 2026 pkg-config contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/* Memory accounting for --memory-stats.  Packages stay loaded until
+ * pkg-config exits, so everything they hold is still reachable then and
+ * can be attributed to them by walking their fields.  The sizes are those
+ * requested from the allocator, without its own overhead; the space
+ * taken by GLib's lists and hash tables is estimated from their layout.
+ * The peak of the whole process comes from the --stats accounting,
+ * when it is available.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "memstats.h"
+#include "pkg.h"
+#include "stats.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef enum
+{
+  MEM_PACKAGE,   /* the Package structure itself */
+  MEM_STRINGS,   /* name, version, description and other fields */
+  MEM_FLAGS,     /* Cflags, Libs and Libs.private */
+  MEM_EDGES,     /* Requires, Requires.private and Conflicts */
+  MEM_VARIABLES, /* names and values of the variables */
+  MEM_HASH,      /* the hash table of the variables */
+  N_MEM_CATEGORIES
+} MemCategory;
+
+static const char *category_names[N_MEM_CATEGORIES] = {
+  "struct",
+  "strings",
+  "flags",
+  "edges",
+  "vars",
+  "hash",
+};
+
+typedef struct
+{
+  const char *key;
+  gsize bytes[N_MEM_CATEGORIES];
+  gsize total;
+} PackageMemory;
+
+static int top_packages = 0;
+
+/* GHashTable keeps its size, counts and callbacks in a structure of
+ * about this size, and three arrays of buckets sized to a power of two
+ * at least twice the number of entries, with a minimum of 8. */
+#define HASH_TABLE_STRUCT_SIZE 80
+#define HASH_TABLE_MIN_SIZE 8
+
+static gsize
+string_size (const char *str)
+{
+  return str != NULL ? strlen (str) + 1 : 0;
+}
+
+static gsize
+hash_table_size (GHashTable *table)
+{
+  guint entries = g_hash_table_size (table);
+  gsize buckets = HASH_TABLE_MIN_SIZE;
+
+  while (buckets < (gsize) entries * 2)
+    buckets *= 2;
+
+  return HASH_TABLE_STRUCT_SIZE +
+    buckets * (2 * sizeof (gpointer) + sizeof (guint));
+}
+
+static gsize
+flags_size (GList *flags)
+{
+  gsize size = 0;
+  GList *iter;
+
+  for (iter = flags; iter != NULL; iter = g_list_next (iter))
+    {
+      Flag *flag = iter->data;
+
+      size += sizeof (GList) + sizeof (Flag) + string_size (flag->arg);
+    }
+
+  return size;
+}
+
+static gsize
+edges_size (GList *entries)
+{
+  gsize size = 0;
+  GList *iter;
+
+  for (iter = entries; iter != NULL; iter = g_list_next (iter))
+    {
+      RequiredVersion *ver = iter->data;
+
+      size += sizeof (GList) + sizeof (RequiredVersion) +
+        string_size (ver->name) + string_size (ver->version);
+    }
+
+  return size;
+}
+
+static void
+measure_package (Package *pkg, PackageMemory *mem)
+{
+  int i;
+
+  memset (mem, 0, sizeof (PackageMemory));
+  mem->key = pkg->key;
+
+  mem->bytes[MEM_PACKAGE] = sizeof (Package);
+  mem->bytes[MEM_STRINGS] = string_size (pkg->key) +
+    string_size (pkg->name) + string_size (pkg->version) +
+    string_size (pkg->description) + string_size (pkg->url) +
+    string_size (pkg->pcfiledir) + string_size (pkg->orig_prefix);
+  mem->bytes[MEM_FLAGS] = flags_size (pkg->cflags) +
+    flags_size (pkg->libs) + flags_size (pkg->libs_private);
+  /* requires and requires_private only hold pointers to other
+   * packages */
+  mem->bytes[MEM_EDGES] = edges_size (pkg->requires_entries) +
+    edges_size (pkg->requires_private_entries) +
+    edges_size (pkg->conflicts) +
+    sizeof (GList) * (g_list_length (pkg->requires) +
+                      g_list_length (pkg->requires_private));
+
+  if (pkg->vars != NULL)
+    {
+      GHashTableIter iter;
+      gpointer key, value;
+
+      /* pcfiledir and pc_path have literal names and values counted
+       * elsewhere */
+      g_hash_table_iter_init (&iter, pkg->vars);
+      while (g_hash_table_iter_next (&iter, &key, &value))
+        if (value != pkg->pcfiledir && value != pkg_config_pc_path)
+          mem->bytes[MEM_VARIABLES] += string_size (key) +
+            string_size (value);
+      mem->bytes[MEM_HASH] = hash_table_size (pkg->vars);
+    }
+
+  for (i = 0; i < N_MEM_CATEGORIES; i++)
+    mem->total += mem->bytes[i];
+}
+
+/* Biggest packages first */
+static int
+package_memory_cmp (const void *a, const void *b)
+{
+  const PackageMemory *x = a;
+  const PackageMemory *y = b;
+
+  if (x->total != y->total)
+    return x->total < y->total ? 1 : -1;
+
+  return strcmp (x->key, y->key);
+}
+
+static void
+format_row (GString *out, const char *label, const gsize *bytes, gsize total)
+{
+  int i;
+
+  g_string_append_printf (out, "%-24s", label);
+  for (i = 0; i < N_MEM_CATEGORIES; i++)
+    g_string_append_printf (out, " %8" G_GSIZE_FORMAT, bytes[i]);
+  g_string_append_printf (out, " %9" G_GSIZE_FORMAT "\n", total);
+}
+
+static void
+memstats_report (void)
+{
+  GList *loaded = packages_get_loaded ();
+  guint n_packages = g_list_length (loaded);
+  PackageMemory *mems = g_new (PackageMemory, MAX (n_packages, 1));
+  PackageMemory sum;
+  GString *out = g_string_new (NULL);
+  gsize peak, live;
+  GList *iter;
+  guint i;
+  int j;
+
+  memset (&sum, 0, sizeof (PackageMemory));
+  for (iter = loaded, i = 0; iter != NULL; iter = g_list_next (iter), i++)
+    {
+      measure_package (iter->data, &mems[i]);
+      for (j = 0; j < N_MEM_CATEGORIES; j++)
+        sum.bytes[j] += mems[i].bytes[j];
+      sum.total += mems[i].total;
+    }
+  qsort (mems, n_packages, sizeof (PackageMemory), package_memory_cmp);
+
+  g_string_append_printf (out, "%-24s", "package");
+  for (j = 0; j < N_MEM_CATEGORIES; j++)
+    g_string_append_printf (out, " %8s", category_names[j]);
+  g_string_append_printf (out, " %9s\n", "total");
+
+  for (i = 0; i < n_packages && i < (guint) top_packages; i++)
+    format_row (out, mems[i].key, mems[i].bytes, mems[i].total);
+  if (n_packages > (guint) top_packages)
+    g_string_append_printf (out, "(%u more)\n", n_packages - top_packages);
+  format_row (out, "all packages", sum.bytes, sum.total);
+
+  g_string_append_printf (out, "%u packages loaded\n", n_packages);
+  if (stats_get_peak (&peak, &live))
+    g_string_append_printf (out, "allocated: peak %" G_GSIZE_FORMAT
+                            " bytes, %" G_GSIZE_FORMAT " bytes at exit\n",
+                            peak, live);
+  else
+    g_string_append (out, "allocated: not counted with this GLib\n");
+
+  fflush (stdout);
+  fwrite (out->str, 1, out->len, stderr);
+  fflush (stderr);
+
+  g_string_free (out, TRUE);
+  g_free (mems);
+  g_list_free (loaded);
+}
+
+void
+memstats_enable (int top)
+{
+  if (top_packages == 0)
+    atexit (memstats_report);
+  top_packages = top;
+}
@@ -0,0 +1,553 @@
+/*
+ * Copyright (C) 2026 pkg-config contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/* Microbenchmarks of the parser, version comparison and flag merging.
+ * The functions measured are static, so parse.c and pkg.c are included
+ * here rather than linked, and main.c is replaced by the few things the
+ * rest of pkg-config needs from it.  Each benchmark is calibrated to
+ * run for about --time seconds, a few times over; the fastest run is
+ * reported in ns per operation, with the cycles and instructions per
+ * operation where Linux perf counters can be read.
+ *
+ * Built with `make microbench`, run with `make bench-micro`.
+ */
+
+#include "parse.c"
+#include "pkg.c"
+#include "json.h"
+
+#ifdef HAVE_LINUX_PERF_EVENT_H
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+char *pcsysrootdir = NULL;
+char *pkg_config_pc_path = "";
+
+void
+debug_spew (const char *format, ...)
+{
+}
+
+void
+debug_log (LogCategory category, const char *format, ...)
+{
+}
+
+void
+verbose_error (const char *format, ...)
+{
+}
+
+/* Runs the benchmark N times and returns the number of operations */
+typedef guint64 (*BenchFunc) (guint64 n);
+
+typedef struct
+{
+  const char *name;
+  BenchFunc func;
+} Bench;
+
+static double run_time = 0.2;
+static int runs = 5;
+static gboolean want_json = FALSE;
+static char *fixtures_dir = "check/gtk";
+
+/* Inputs, set up once */
+static GPtrArray *fixture_files;
+static GPtrArray *versions;
+static Package *var_pkg;
+static char *var_line;
+static char *module_line;
+static char *libs_line;
+static char *cflags_line;
+static GList *closure;
+
+/* Keep results alive so the compiler cannot drop the work */
+static volatile gsize sink;
+
+static void
+free_flags (GList *flags)
+{
+  GList *iter;
+
+  for (iter = flags; iter != NULL; iter = g_list_next (iter))
+    {
+      Flag *flag = iter->data;
+      g_free (flag->arg);
+      g_free (flag);
+    }
+  g_list_free (flags);
+}
+
+static guint64
+bench_read_one_line (guint64 n)
+{
+  GString *str = g_string_new (NULL);
+  guint64 ops = 0;
+  guint64 i;
+  guint f;
+
+  for (i = 0; i < n; i++)
+    for (f = 0; f < fixture_files->len; f++)
+      {
+        FILE *stream = g_ptr_array_index (fixture_files, f);
+
+        rewind (stream);
+        while (read_one_line (stream, str))
+          {
+            sink += str->len;
+            ops++;
+          }
+      }
+
+  g_string_free (str, TRUE);
+  return ops;
+}
+
+static guint64
+bench_trim_and_sub (guint64 n)
+{
+  guint64 i;
+
+  for (i = 0; i < n; i++)
+    {
+      char *str = trim_and_sub (var_pkg, var_line, "bench");
+      sink += strlen (str);
+      g_free (str);
+    }
+
+  return n;
+}
+
+static guint64
+bench_split_module_list (guint64 n)
+{
+  guint64 i;
+
+  for (i = 0; i < n; i++)
+    {
+      GList *list = split_module_list (module_line, "bench");
+      sink += g_list_length (list);
+      g_list_free_full (list, g_free);
+    }
+
+  return n;
+}
+
+static guint64
+bench_parse_libs (guint64 n)
+{
+  guint64 i;
+
+  for (i = 0; i < n; i++)
+    {
+      GList *libs = NULL;
+
+      parse_libs (var_pkg, &libs, "Libs", libs_line, "bench");
+      sink += g_list_length (libs);
+      free_flags (libs);
+    }
+
+  return n;
+}
+
+static guint64
+bench_parse_cflags (guint64 n)
+{
+  guint64 i;
+
+  for (i = 0; i < n; i++)
+    {
+      parse_cflags (var_pkg, cflags_line, "bench");
+      sink += g_list_length (var_pkg->cflags);
+      free_flags (var_pkg->cflags);
+      var_pkg->cflags = NULL;
+    }
+
+  return n;
+}
+
+static guint64
+bench_rpmvercmp (guint64 n)
+{
+  guint64 i;
+  guint a, b;
+
+  for (i = 0; i < n; i++)
+    for (a = 0; a < versions->len; a++)
+      for (b = 0; b < versions->len; b++)
+        sink += rpmvercmp (g_ptr_array_index (versions, a),
+                           g_ptr_array_index (versions, b)) + 1;
+
+  return n * versions->len * versions->len;
+}
+
+static guint64
+bench_merge_flag_lists (guint64 n)
+{
+  guint64 i;
+
+  for (i = 0; i < n; i++)
+    {
+      GList *merged = merge_flag_lists (closure, LIBS_ANY | CFLAGS_ANY);
+      sink += GPOINTER_TO_SIZE (merged);
+      g_list_free (merged);
+    }
+
+  return n;
+}
+
+static guint64
+bench_strip_duplicates (guint64 n)
+{
+  guint64 i;
+
+  for (i = 0; i < n; i++)
+    {
+      GList *merged = merge_flag_lists (closure, LIBS_ANY | CFLAGS_ANY);
+      merged = flag_list_strip_duplicates (merged);
+      sink += GPOINTER_TO_SIZE (merged);
+      g_list_free (merged);
+    }
+
+  return n;
+}
+
+static const Bench benches[] = {
+  { "read_one_line", bench_read_one_line },
+  { "trim_and_sub", bench_trim_and_sub },
+  { "split_module_list", bench_split_module_list },
+  { "parse_libs", bench_parse_libs },
+  { "parse_cflags", bench_parse_cflags },
+  { "rpmvercmp", bench_rpmvercmp },
+  { "merge_flag_lists", bench_merge_flag_lists },
+  { "merge_flag_lists+strip_duplicates", bench_strip_duplicates },
+};
+
+static void
+setup_fixtures (void)
+{
+  GDir *dir;
+  const char *name;
+  GList *names = NULL;
+  GList *iter;
+  GList *roots = NULL;
+  GList *expanded;
+  GString *modules = g_string_new (NULL);
+  GString *str;
+  int i;
+
+  dir = g_dir_open (fixtures_dir, 0, NULL);
+  if (dir == NULL)
+    {
+      fprintf (stderr, "Cannot open fixtures directory: %s\n", fixtures_dir);
+      exit (1);
+    }
+  while ((name = g_dir_read_name (dir)) != NULL)
+    if (g_str_has_suffix (name, ".pc"))
+      names = g_list_prepend (names, g_strdup (name));
+  g_dir_close (dir);
+  names = g_list_sort (names, (GCompareFunc) strcmp);
+
+  /* The .pc files, their versions and all the packages they require */
+  add_search_dir (fixtures_dir);
+  package_init (FALSE);
+  fixture_files = g_ptr_array_new ();
+  versions = g_ptr_array_new ();
+  for (iter = names; iter != NULL; iter = g_list_next (iter))
+    {
+      char *path = g_build_filename (fixtures_dir, iter->data, NULL);
+      char *key = g_strndup (iter->data, strlen (iter->data) - EXT_LEN);
+      FILE *stream = fopen (path, "r");
+      Package *pkg;
+
+      if (stream != NULL)
+        g_ptr_array_add (fixture_files, stream);
+
+      pkg = get_package (key);
+      if (pkg != NULL)
+        {
+          g_ptr_array_add (versions, pkg->version);
+          roots = g_list_append (roots, pkg);
+        }
+      g_string_append_printf (modules, "%s%s >= %s", modules->len ? ", " : "",
+                              key, pkg ? pkg->version : "1.0");
+      g_free (key);
+      g_free (path);
+    }
+  g_list_free_full (names, g_free);
+
+  /* Other version styles found in the wild */
+  {
+    static char *more[] = {
+      "1.0", "1.0.1", "1.0a", "1.0~rc1", "1.0-beta2", "2.4.10", "2.40.0",
+      "20231004", "1:2.3.4", "3.0.0+git20240102", "0.9.8zh", "1.2.3.4.5",
+    };
+    for (i = 0; i < (int) G_N_ELEMENTS (more); i++)
+      g_ptr_array_add (versions, more[i]);
+  }
+
+  /* A long Requires line: all the fixtures, four times over */
+  str = g_string_new (NULL);
+  for (i = 0; i < 4; i++)
+    g_string_append_printf (str, "%s%s", i ? ", " : "", modules->str);
+  module_line = g_string_free (str, FALSE);
+  g_string_free (modules, TRUE);
+
+  /* A chain of 64 variables, each defined by the one before, as parse.c
+   * stores them: expanded.  The line uses every 4th. */
+  var_pkg = g_new0 (Package, 1);
+  var_pkg->key = "bench";
+  var_pkg->vars = g_hash_table_new (g_str_hash, g_str_equal);
+  str = g_string_new ("/opt/bench");
+  g_hash_table_insert (var_pkg->vars, "v0", g_strdup (str->str));
+  for (i = 1; i < 64; i++)
+    {
+      g_string_append_printf (str, "/d%d", i);
+      g_hash_table_insert (var_pkg->vars, g_strdup_printf ("v%d", i),
+                           g_strdup (str->str));
+    }
+  g_string_free (str, TRUE);
+  str = g_string_new (NULL);
+  for (i = 0; i < 64; i += 4)
+    g_string_append_printf (str, "-I${v%d}/include ", i);
+  var_line = g_string_free (str, FALSE);
+
+  /* Long Libs and Cflags lines of 300 flags */
+  str = g_string_new (NULL);
+  for (i = 0; i < 100; i++)
+    g_string_append_printf (str, "-L/opt/lib%d/lib -llib%d "
+                            "-Wl,-rpath,/opt/lib%d/lib ", i, i, i);
+  libs_line = g_string_free (str, FALSE);
+  str = g_string_new (NULL);
+  for (i = 0; i < 100; i++)
+    g_string_append_printf (str, "-I/opt/lib%d/include -DLIB%d=1 "
+                            "-isystem /opt/lib%d/sys ", i, i, i);
+  cflags_line = g_string_free (str, FALSE);
+
+  /* The closure of every fixture, in path order with the private
+   * requirements, repeated as in a large build's link line */
+  expanded = fill_package_list (roots, TRUE, TRUE);
+  for (i = 0; i < 16; i++)
+    closure = g_list_concat (closure, g_list_copy (expanded));
+  g_list_free (expanded);
+  g_list_free (roots);
+}
+
+#ifdef HAVE_LINUX_PERF_EVENT_H
+static int perf_group = -1;
+
+static int
+perf_open (guint64 config, int group)
+{
+  struct perf_event_attr attr;
+
+  memset (&attr, 0, sizeof attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.size = sizeof attr;
+  attr.config = config;
+  attr.disabled = group == -1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP;
+
+  return syscall (__NR_perf_event_open, &attr, 0, -1, group, 0);
+}
+
+static void
+perf_init (void)
+{
+  perf_group = perf_open (PERF_COUNT_HW_CPU_CYCLES, -1);
+  if (perf_group >= 0 && perf_open (PERF_COUNT_HW_INSTRUCTIONS,
+                                    perf_group) < 0)
+    {
+      close (perf_group);
+      perf_group = -1;
+    }
+}
+
+static void
+perf_start (void)
+{
+  if (perf_group < 0)
+    return;
+  ioctl (perf_group, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+  ioctl (perf_group, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+static gboolean
+perf_stop (guint64 *cycles, guint64 *instructions)
+{
+  guint64 values[3];
+
+  if (perf_group < 0)
+    return FALSE;
+  ioctl (perf_group, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+  if (read (perf_group, values, sizeof values) != sizeof values)
+    return FALSE;
+  *cycles = values[1];
+  *instructions = values[2];
+
+  return TRUE;
+}
+#else
+static void
+perf_init (void)
+{
+}
+
+static void
+perf_start (void)
+{
+}
+
+static gboolean
+perf_stop (guint64 *cycles, guint64 *instructions)
+{
+  return FALSE;
+}
+#endif
+
+static void
+run_bench (const Bench *bench, gboolean first)
+{
+  guint64 n = 1;
+  guint64 ops;
+  gint64 start;
+  gint64 elapsed;
+  double best_ns = -1;
+  double best_cycles = -1;
+  double best_instructions = -1;
+  int r;
+
+  /* find how many rounds take --time */
+  for (;;)
+    {
+      start = g_get_monotonic_time ();
+      bench->func (n);
+      elapsed = g_get_monotonic_time () - start;
+      if (elapsed >= run_time * 1e6 / 10 || n >= G_MAXUINT32)
+        break;
+      n *= 2;
+    }
+  if (elapsed > 0)
+    n = MAX (1, n * (run_time * 1e6) / elapsed);
+
+  for (r = 0; r < runs; r++)
+    {
+      guint64 cycles, instructions;
+      double ns;
+
+      perf_start ();
+      start = g_get_monotonic_time ();
+      ops = bench->func (n);
+      elapsed = g_get_monotonic_time () - start;
+      ns = elapsed * 1000.0 / ops;
+      if (best_ns < 0 || ns < best_ns)
+        {
+          best_ns = ns;
+          if (perf_stop (&cycles, &instructions))
+            {
+              best_cycles = (double) cycles / ops;
+              best_instructions = (double) instructions / ops;
+            }
+        }
+      else
+        perf_stop (&cycles, &instructions);
+    }
+
+  if (want_json)
+    {
+      GString *out = g_string_new (first ? "" : ",");
+
+      g_string_append (out, "{\"name\":");
+      json_append_string (out, bench->name);
+      g_string_append_printf (out, ",\"ns_per_op\":%.2f", best_ns);
+      if (best_cycles >= 0)
+        g_string_append_printf (out, ",\"cycles_per_op\":%.1f"
+                                ",\"instructions_per_op\":%.1f",
+                                best_cycles, best_instructions);
+      g_string_append (out, "}");
+      printf ("%s", out->str);
+      g_string_free (out, TRUE);
+    }
+  else if (best_cycles >= 0)
+    printf ("%-36s %12.2f ns/op %12.1f cycles/op %12.1f instructions/op\n",
+            bench->name, best_ns, best_cycles, best_instructions);
+  else
+    printf ("%-36s %12.2f ns/op\n", bench->name, best_ns);
+  fflush (stdout);
+}
+
+static const GOptionEntry options_table[] = {
+  { "time", 0, 0, G_OPTION_ARG_DOUBLE, &run_time,
+    "seconds to run each benchmark for (default 0.2)", "SECONDS" },
+  { "runs", 0, 0, G_OPTION_ARG_INT, &runs,
+    "runs of each benchmark; the fastest is reported (default 5)", "N" },
+  { "fixtures", 0, 0, G_OPTION_ARG_FILENAME, &fixtures_dir,
+    "directory of .pc files to use as input (default check/gtk)", "DIR" },
+  { "json", 0, 0, G_OPTION_ARG_NONE, &want_json,
+    "print the results as a JSON array", NULL },
+  { NULL, 0, 0, 0, NULL, NULL, NULL }
+};
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *opt_context;
+  GError *error = NULL;
+  gboolean first = TRUE;
+  guint i;
+
+  opt_context = g_option_context_new ("[NAME...]");
+  g_option_context_set_summary (opt_context, "Run the benchmarks whose names "
+                                "contain one of NAME, or all of them.");
+  g_option_context_add_main_entries (opt_context, options_table, NULL);
+  if (!g_option_context_parse (opt_context, &argc, &argv, &error))
+    {
+      fprintf (stderr, "%s\n", error->message);
+      return 1;
+    }
+  runs = MAX (runs, 1);
+
+  setup_fixtures ();
+  perf_init ();
+
+  if (want_json)
+    printf ("[");
+  for (i = 0; i < G_N_ELEMENTS (benches); i++)
+    {
+      gboolean wanted = argc < 2;
+      int a;
+
+      for (a = 1; a < argc && !wanted; a++)
+        wanted = strstr (benches[i].name, argv[a]) != NULL;
+      if (!wanted)
+        continue;
+
+      run_bench (&benches[i], first);
+      first = FALSE;
+    }
+  if (want_json)
+    printf ("]\n");
+
+  return 0;
+}
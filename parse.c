@@ -24,6 +24,10 @@
 #endif
 
 #include "parse.h"
+#include "probes.h"
+#include "stats.h"
+#include "timings.h"
+#include "trace.h"
 #include <stdio.h>
 #include <errno.h>
 #include <string.h>
@@ -47,6 +51,63 @@ char *prefix_variable = "prefix";
 gboolean msvc_syntax = FALSE;
 #endif
 
+/* The GPtrArray that parse_package_file_collect gathers the current
+ * thread's errors in, if any. */
+static GPrivate collected_errors;
+/* The gboolean that parse_package_file_checked sets on an error that
+ * stops strict parsing, if any. */
+static GPrivate failed_flag;
+
+static void
+report_error (gboolean fatal, const char *format, va_list args)
+{
+  GPtrArray *errors = g_private_get (&collected_errors);
+  char *msg;
+
+  msg = g_strdup_vprintf (format, args);
+  if (errors != NULL)
+    {
+      g_ptr_array_add (errors, g_strchomp (msg));
+      return;
+    }
+
+  verbose_error ("%s", msg);
+  g_free (msg);
+
+  if (fatal && parse_strict)
+    {
+      gboolean *failedp = g_private_get (&failed_flag);
+
+      if (failedp == NULL)
+        exit (1);
+      *failedp = TRUE;
+    }
+}
+
+/* Report a malformed .pc file.  This is fatal when parsing strictly,
+ * unless the errors are being collected or checked; otherwise the
+ * caller skips over what it could not parse. */
+static void
+parse_error (const char *format, ...)
+{
+  va_list args;
+
+  va_start (args, format);
+  report_error (TRUE, format, args);
+  va_end (args);
+}
+
+/* Report a problem that does not stop even strict parsing. */
+static void
+parse_warning (const char *format, ...)
+{
+  va_list args;
+
+  va_start (args, format);
+  report_error (FALSE, format, args);
+  va_end (args);
+}
+
 /**
  * Read an entire line from a file into a buffer. Lines may
  * be delimited with '\n', '\r', '\n\r', or '\r\n'. The delimiter
@@ -196,20 +257,18 @@ trim_and_sub (Package *pkg, const char *str, const char *path)
           varname = g_strndup (var_start, p - var_start);
 
           ++p; /* past brace */
+          stats_add (STAT_VARIABLES_EXPANDED, 1);
           
           varval = package_get_var (pkg, varname);
           
           if (varval == NULL)
-            {
-              verbose_error ("Variable '%s' not defined in '%s'\n",
-                             varname, path);
-              if (parse_strict)
-                exit (1);
-            }
+            parse_error ("Variable '%s' not defined in '%s'\n",
+                         varname, path);
 
           g_free (varname);
 
-          g_string_append (subst, varval);
+          if (varval != NULL)
+            g_string_append (subst, varval);
           g_free (varval);
         }
       else
@@ -232,11 +291,8 @@ parse_name (Package *pkg, const char *str, const char *path)
 {
   if (pkg->name)
     {
-      verbose_error ("Name field occurs twice in '%s'\n", path);
-      if (parse_strict)
-        exit (1);
-      else
-        return;
+      parse_error ("Name field occurs twice in '%s'\n", path);
+      return;
     }
   
   pkg->name = trim_and_sub (pkg, str, path);
@@ -247,11 +303,8 @@ parse_version (Package *pkg, const char *str, const char *path)
 {
   if (pkg->version)
     {
-      verbose_error ("Version field occurs twice in '%s'\n", path);
-      if (parse_strict)
-        exit (1);
-      else
-        return;
+      parse_error ("Version field occurs twice in '%s'\n", path);
+      return;
     }
   
   pkg->version = trim_and_sub (pkg, str, path);
@@ -262,11 +315,8 @@ parse_description (Package *pkg, const char *str, const char *path)
 {
   if (pkg->description)
     {
-      verbose_error ("Description field occurs twice in '%s'\n", path);
-      if (parse_strict)
-        exit (1);
-      else
-        return;
+      parse_error ("Description field occurs twice in '%s'\n", path);
+      return;
     }
   
   pkg->description = trim_and_sub (pkg, str, path);
@@ -473,13 +523,10 @@ do_parse_module_list (Package *pkg, GList **listp,
             ver->comparison = NOT_EQUAL;
           else
             {
-              verbose_error ("Unknown version comparison operator '%s' after "
-                             "package name '%s' in file '%s'\n", start,
-                             ver->name, path);
-              if (parse_strict)
-                exit (1);
-              else
-                continue;
+              parse_error ("Unknown version comparison operator '%s' after "
+                           "package name '%s' in file '%s'\n", start,
+                           ver->name, path);
+              continue;
             }
         }
 
@@ -496,15 +543,10 @@ do_parse_module_list (Package *pkg, GList **listp,
       
       if (ver->comparison != ALWAYS_MATCH && *start == '\0')
         {
-          verbose_error ("Comparison operator but no version after package "
-                         "name '%s' in file '%s'\n", ver->name, path);
-          if (parse_strict)
-            exit (1);
-          else
-            {
-              ver->version = g_strdup ("0");
-              continue;
-            }
+          parse_error ("Comparison operator but no version after package "
+                       "name '%s' in file '%s'\n", ver->name, path);
+          ver->version = g_strdup ("0");
+          continue;
         }
 
       if (*start != '\0')
@@ -536,7 +578,7 @@ parse_deps (Package *pkg, GList **listp, const char *str, const char *path)
   g_free (trimmed);
 }
 
-static char *strdup_escape_shell(const char *s)
+char *strdup_escape_shell(const char *s)
 {
 	size_t r_s = strlen(s)+10, c = 0;
 	char *r = g_malloc(r_s);
@@ -588,6 +630,7 @@ do_parse_libs (GList **listp, int argc, char **argv)
       char *p;
       p = arg;
       g_free(tmp);
+      stats_add (STAT_FLAGS_CREATED, 1);
 
       if (p[0] == '-' &&
           p[1] == 'l' &&
@@ -664,15 +707,10 @@ parse_libs (Package *pkg, GList **listp, const char *field,
   if (trimmed && *trimmed &&
       !g_shell_parse_argv (trimmed, &argc, &argv, &error))
     {
-      verbose_error ("Couldn't parse %s field into an argument vector: %s\n",
-                     field, error ? error->message : "unknown");
-      if (parse_strict)
-        exit (1);
-      else
-        {
-          g_free (trimmed);
-          return;
-        }
+      parse_error ("Couldn't parse %s field into an argument vector: %s\n",
+                   field, error ? error->message : "unknown");
+      g_free (trimmed);
+      return;
     }
 
   do_parse_libs (listp, argc, argv);
@@ -697,15 +735,10 @@ parse_cflags (Package *pkg, const char *str, const char *path)
   if (trimmed && *trimmed &&
       !g_shell_parse_argv (trimmed, &argc, &argv, &error))
     {
-      verbose_error ("Couldn't parse Cflags field into an argument vector: %s\n",
-                     error ? error->message : "unknown");
-      if (parse_strict)
-        exit (1);
-      else
-        {
-          g_free (trimmed);
-          return;
-        }
+      parse_error ("Couldn't parse Cflags field into an argument vector: %s\n",
+                   error ? error->message : "unknown");
+      g_free (trimmed);
+      return;
     }
 
   i = 0;
@@ -716,6 +749,7 @@ parse_cflags (Package *pkg, const char *str, const char *path)
       char *arg = strdup_escape_shell(tmp);
       char *p = arg;
       g_free(tmp);
+      stats_add (STAT_FLAGS_CREATED, 1);
 
       if (p[0] == '-' &&
           p[1] == 'I')
@@ -769,11 +803,8 @@ parse_url (Package *pkg, const char *str, const char *path)
 {
   if (pkg->url != NULL)
     {
-      verbose_error ("URL field occurs twice in '%s'\n", path);
-      if (parse_strict)
-        exit (1);
-      else
-        return;
+      parse_error ("URL field occurs twice in '%s'\n", path);
+      return;
     }
 
   pkg->url = trim_and_sub (pkg, str, path);
@@ -786,7 +817,7 @@ parse_line (Package *pkg, const char *untrimmed, const char *path)
   char *p;
   char *tag;
 
-  debug_spew ("  line>%s\n", untrimmed);
+  debug_log (LOG_PARSE, "  line>%s\n", untrimmed);
   
   str = trim_string (untrimmed);
   
@@ -845,8 +876,8 @@ parse_line (Package *pkg, const char *untrimmed, const char *path)
 	   * versions of pkg-config.  We do make a note of them in the
 	   * debug spew though, in order to help catch mistakes in .pc
 	   * files. */
-          debug_spew ("Unknown keyword '%s' in '%s'\n",
-		      tag, path);
+          debug_log (LOG_PARSE, "Unknown keyword '%s' in '%s'\n",
+                     tag, path);
         }
     }
   else if (*p == '=')
@@ -904,8 +935,9 @@ parse_line (Package *pkg, const char *untrimmed, const char *path)
 	      g_free (q);
 
 	      varname = g_strdup (tag);
-	      debug_spew (" Variable declaration, '%s' overridden with '%s'\n",
-			  tag, prefix);
+	      debug_log (LOG_PARSE,
+                         " Variable declaration, '%s' overridden with '%s'\n",
+                         tag, prefix);
 	      g_hash_table_insert (pkg->vars, varname, prefix);
 	      goto cleanup;
 	    }
@@ -925,19 +957,16 @@ parse_line (Package *pkg, const char *untrimmed, const char *path)
 
       if (g_hash_table_lookup (pkg->vars, tag))
         {
-          verbose_error ("Duplicate definition of variable '%s' in '%s'\n",
-                         tag, path);
-          if (parse_strict)
-            exit (1);
-          else
-            goto cleanup;
+          parse_error ("Duplicate definition of variable '%s' in '%s'\n",
+                       tag, path);
+          goto cleanup;
         }
 
       varname = g_strdup (tag);
       varval = trim_and_sub (pkg, p, path);     
 
-      debug_spew (" Variable declaration, '%s' has value '%s'\n",
-                  varname, varval);
+      debug_log (LOG_PARSE, " Variable declaration, '%s' has value '%s'\n",
+                 varname, varval);
       g_hash_table_insert (pkg->vars, varname, varval);
   
     }
@@ -953,19 +982,27 @@ parse_package_file (const char *key, const char *path)
   FILE *f;
   Package *pkg;
   GString *str;
-  gboolean one_line = FALSE;
+  int lines = 0;
+  gint64 start = want_timings ? g_get_monotonic_time () : 0;
   
+  trace_begin ("parse_package_file", key, path);
+  timings_push (PHASE_READ);
   f = fopen (path, "r");
+  PROBE2 (file__open, path, f == NULL ? errno : 0);
 
   if (f == NULL)
     {
-      verbose_error ("Failed to open '%s': %s\n",
+      parse_warning ("Failed to open '%s': %s\n",
                      path, strerror (errno));
       
+      timings_pop ();
+      trace_end (NULL);
       return NULL;
     }
 
-  debug_spew ("Parsing package file '%s'\n", path);
+  debug_log (LOG_PARSE, "Parsing package file '%s'\n", path);
+  PROBE2 (parse__start, key, path);
+  stats_add (STAT_FILES_OPENED, 1);
   
   pkg = g_new0 (Package, 1);
   pkg->key = g_strdup (key);
@@ -976,7 +1013,7 @@ parse_package_file (const char *key, const char *path)
     }
   else
     {
-      debug_spew ("No pcfiledir determined for package\n");
+      debug_log (LOG_PARSE, "No pcfiledir determined for package\n");
       pkg->pcfiledir = g_strdup ("???????");
     }
 
@@ -990,17 +1027,21 @@ parse_package_file (const char *key, const char *path)
 
   while (read_one_line (f, str))
     {
-      one_line = TRUE;
+      lines++;
       
+      timings_push (PHASE_PARSE);
       parse_line (pkg, str->str, path);
+      timings_pop ();
+      stats_add (STAT_LINES_PARSED, 1);
 
       g_string_truncate (str, 0);
     }
 
-  if (!one_line)
-    verbose_error ("Package file '%s' appears to be empty\n",
+  if (lines == 0)
+    parse_warning ("Package file '%s' appears to be empty\n",
                    path);
   g_string_free (str, TRUE);
+  stats_add (STAT_BYTES_READ, ftell (f));
   fclose(f);
 
   pkg->requires_entries = g_list_reverse (pkg->requires_entries);
@@ -1010,10 +1051,43 @@ parse_package_file (const char *key, const char *path)
   pkg->cflags = g_list_reverse (pkg->cflags);
   pkg->libs = g_list_reverse (pkg->libs);
   pkg->libs_private = g_list_reverse (pkg->libs_private);
+
+  timings_pop ();
+  if (want_timings)
+    timings_file (path, g_get_monotonic_time () - start);
+  trace_end (NULL);
+  PROBE3 (parse__end, pkg->key, path, lines);
   
   return pkg;
 }
 
+Package *
+parse_package_file_collect (const char *key, const char *path,
+                            GPtrArray *errors)
+{
+  Package *pkg;
+
+  g_private_set (&collected_errors, errors);
+  pkg = parse_package_file (key, path);
+  g_private_set (&collected_errors, NULL);
+
+  return pkg;
+}
+
+Package *
+parse_package_file_checked (const char *key, const char *path,
+                            gboolean *failedp)
+{
+  Package *pkg;
+
+  *failedp = FALSE;
+  g_private_set (&failed_flag, failedp);
+  pkg = parse_package_file (key, path);
+  g_private_set (&failed_flag, NULL);
+
+  return pkg;
+}
+
 /* Parse a package variable. When the value appears to be quoted,
  * unquote it so it can be more easily used in a shell. Otherwise,
  * return the raw value.
@@ -1043,8 +1117,8 @@ parse_package_variable (Package *pkg, const char *variable)
   else
     {
       /* Note the issue, but just return the raw value */
-      debug_spew ("Couldn't unquote value of \"%s\": %s\n",
-                  variable, error ? error->message : "unknown");
+      debug_log (LOG_PARSE, "Couldn't unquote value of \"%s\": %s\n",
+                 variable, error ? error->message : "unknown");
       g_clear_error (&error);
       return value;
     }
@@ -24,10 +24,27 @@
 
 Package *parse_package_file (const char *key, const char *path);
 
+/* Parse the .pc file PATH like parse_package_file, but add a message to
+ * ERRORS for each problem instead of printing it, and never exit.  The
+ * problems are the ones that stop strict parsing, plus an unreadable or
+ * empty file; parsing goes on past them as when not parsing strictly.
+ */
+Package *parse_package_file_collect (const char *key, const char *path,
+                                     GPtrArray *errors);
+
+/* Parse the .pc file PATH like parse_package_file, printing the problems
+ * as usual, but set *FAILEDP instead of exiting on the ones that stop
+ * strict parsing.  Parsing goes on past them.
+ */
+Package *parse_package_file_checked (const char *key, const char *path,
+                                     gboolean *failedp);
+
 GList   *parse_module_list (Package *pkg, const char *str, const char *path);
 
 char    *parse_package_variable (Package *pkg, const char *variable);
 
+char    *strdup_escape_shell (const char *s);
+
 #endif
 
 
@@ -25,6 +25,15 @@
 #include "pkg.h"
 #include "parse.h"
 #include "rpmvercmp.h"
+#include "resolve.h"
+#include "farm.h"
+#include "elfsyms.h"
+#include "pkgindex.h"
+#include "includes.h"
+#include "stats.h"
+#include "timings.h"
+#include "trace.h"
+#include "probes.h"
 
 #ifdef HAVE_MALLOC_H
 # include <malloc.h>
@@ -40,17 +49,26 @@
 #include <stdlib.h>
 #include <ctype.h>
 
-static void verify_package (Package *pkg);
+static gboolean verify_package (Package *pkg);
 
 static GHashTable *packages = NULL;
 static GHashTable *globals = NULL;
 static GList *search_dirs = NULL;
+/* Whether --libs-resolved prefers archives, as given by --static */
+static gboolean resolve_static = FALSE;
+/* Whether a package that cannot be loaded ends pkg-config, and if not,
+ * the packages that failed since packages_forget_failed */
+static gboolean errors_fatal = TRUE;
+static GList *failed = NULL;
+static guint n_failed = 0;
 
 gboolean disable_uninstalled = FALSE;
 gboolean ignore_requires = FALSE;
 gboolean ignore_requires_private = TRUE;
 gboolean tolerate_missing_requires_private = FALSE;
 gboolean ignore_private_libs = TRUE;
+gboolean resolve_libs = FALSE;
+char *include_farm_dir = NULL;
 
 void
 add_search_dir (const char *path)
@@ -58,6 +76,12 @@ add_search_dir (const char *path)
   search_dirs = g_list_append (search_dirs, g_strdup (path));
 }
 
+GList *
+get_search_dirs (void)
+{
+  return search_dirs;
+}
+
 void
 add_search_dirs (const char *path, const char *separator)
 {
@@ -69,8 +93,8 @@ add_search_dirs (const char *path, const char *separator)
       iter = search_dirs;
       while (*iter)
         {
-          debug_spew ("Adding directory '%s' from PKG_CONFIG_PATH\n",
-                      *iter);
+          debug_log (LOG_LOOKUP, "Adding directory '%s' from PKG_CONFIG_PATH\n",
+                     *iter);
           add_search_dir (*iter);
           
           ++iter;
@@ -158,17 +182,19 @@ scan_dir (char *dirname)
         }
     }
 #endif
+  stats_add (STAT_DIRS_READ, 1);
   dir = g_dir_open (dirname_copy, 0 , NULL);
   g_free (dirname_copy);
 
   if (!dir)
     {
-      debug_spew ("Cannot open directory '%s' in package search path: %s\n",
-                  dirname, g_strerror (errno));
+      debug_log (LOG_LOOKUP,
+                 "Cannot open directory '%s' in package search path: %s\n",
+                 dirname, g_strerror (errno));
       return;
     }
 
-  debug_spew ("Scanning directory '%s'\n", dirname);
+  debug_log (LOG_LOOKUP, "Scanning directory '%s'\n", dirname);
 
   while ((filename = g_dir_read_name(dir)))
     {
@@ -197,7 +223,8 @@ add_virtual_pkgconfig_package (void)
     pkg->vars = g_hash_table_new (g_str_hash, g_str_equal);
   g_hash_table_insert (pkg->vars, "pc_path", pkg_config_pc_path);
 
-  debug_spew ("Adding virtual 'pkg-config' package to list of known packages\n");
+  debug_log (LOG_LOOKUP,
+             "Adding virtual 'pkg-config' package to list of known packages\n");
   g_hash_table_insert (packages, pkg->key, pkg);
 
   return pkg;
@@ -221,6 +248,226 @@ package_init (gboolean want_list)
 }
 
 static void
+required_version_free (gpointer data)
+{
+  RequiredVersion *ver = data;
+
+  g_free (ver->name);
+  g_free (ver->version);
+  g_free (ver);
+}
+
+static void
+flag_free (gpointer data)
+{
+  Flag *flag = data;
+
+  g_free (flag->arg);
+  g_free (flag);
+}
+
+static void
+package_free (Package *pkg)
+{
+  if (pkg->vars != NULL)
+    {
+      GHashTableIter iter;
+      gpointer key, value;
+
+      /* pcfiledir and pc_path are inserted with literal names and
+       * values owned elsewhere */
+      g_hash_table_iter_init (&iter, pkg->vars);
+      while (g_hash_table_iter_next (&iter, &key, &value))
+        if (value != pkg->pcfiledir && value != pkg_config_pc_path)
+          {
+            g_free (key);
+            g_free (value);
+          }
+      g_hash_table_destroy (pkg->vars);
+    }
+
+  g_list_free_full (pkg->requires_entries, required_version_free);
+  g_list_free_full (pkg->requires_private_entries, required_version_free);
+  g_list_free_full (pkg->conflicts, required_version_free);
+  g_list_free (pkg->requires);
+  g_list_free (pkg->requires_private);
+  g_list_free_full (pkg->libs, flag_free);
+  g_list_free_full (pkg->libs_private, flag_free);
+  g_list_free_full (pkg->cflags, flag_free);
+
+  g_free (pkg->key);
+  g_free (pkg->name);
+  g_free (pkg->version);
+  g_free (pkg->description);
+  g_free (pkg->url);
+  g_free (pkg->pcfiledir);
+  g_free (pkg->orig_prefix);
+  g_free (pkg);
+}
+
+static gboolean
+requires_any (Package *pkg, GHashTable *set)
+{
+  GList *iter;
+
+  for (iter = pkg->requires; iter != NULL; iter = g_list_next (iter))
+    if (g_hash_table_lookup (set, iter->data))
+      return TRUE;
+  for (iter = pkg->requires_private; iter != NULL; iter = g_list_next (iter))
+    if (g_hash_table_lookup (set, iter->data))
+      return TRUE;
+
+  return FALSE;
+}
+
+/* Free the packages in DOOMED and the loaded packages requiring them,
+ * and return how many there were */
+static int
+forget_packages (GHashTable *doomed)
+{
+  GList *loaded, *iter;
+  gboolean changed;
+  int n_forgotten;
+
+  /* The packages requiring a forgotten one point to it, so they have to
+   * go too */
+  loaded = g_hash_table_get_values (packages);
+  do
+    {
+      changed = FALSE;
+      for (iter = loaded; iter != NULL; iter = g_list_next (iter))
+        if (!g_hash_table_lookup (doomed, iter->data) &&
+            requires_any (iter->data, doomed))
+          {
+            g_hash_table_insert (doomed, iter->data, iter->data);
+            changed = TRUE;
+          }
+    }
+  while (changed);
+  g_list_free (loaded);
+
+  loaded = g_hash_table_get_keys (doomed);
+  for (iter = loaded; iter != NULL; iter = g_list_next (iter))
+    {
+      Package *pkg = iter->data;
+
+      debug_log (LOG_LOOKUP, "Forgetting package '%s'\n", pkg->key);
+      if (g_hash_table_lookup (packages, pkg->key) == pkg)
+        g_hash_table_remove (packages, pkg->key);
+      package_free (pkg);
+    }
+  n_forgotten = g_list_length (loaded);
+  g_list_free (loaded);
+  g_hash_table_destroy (doomed);
+
+  return n_forgotten;
+}
+
+int
+packages_forget (GList *keys)
+{
+  GHashTable *doomed;
+  GList *iter;
+
+  if (packages == NULL)
+    return 0;
+
+  doomed = g_hash_table_new (NULL, NULL);
+  for (iter = keys; iter != NULL; iter = g_list_next (iter))
+    {
+      Package *pkg = g_hash_table_lookup (packages, iter->data);
+
+      if (pkg != NULL && pkg->pcfiledir != NULL)
+        g_hash_table_insert (doomed, pkg, pkg);
+    }
+
+  return forget_packages (doomed);
+}
+
+void
+packages_set_errors_fatal (gboolean fatal)
+{
+  errors_fatal = fatal;
+}
+
+int
+packages_forget_failed (void)
+{
+  GHashTable *doomed;
+  GList *iter;
+
+  if (failed == NULL)
+    return 0;
+
+  doomed = g_hash_table_new (NULL, NULL);
+  for (iter = failed; iter != NULL; iter = g_list_next (iter))
+    g_hash_table_insert (doomed, iter->data, iter->data);
+  g_list_free (failed);
+  failed = NULL;
+
+  return forget_packages (doomed);
+}
+
+/* Give up on PKG, which cannot be loaded.  Unless errors are fatal, it
+ * is taken out of the known packages and kept until
+ * packages_forget_failed, as packages that were loaded with it may
+ * point to it. */
+static void
+package_failed (Package *pkg)
+{
+  if (errors_fatal)
+    exit (1);
+
+  debug_log (LOG_LOOKUP, "Failed to load package '%s'\n", pkg->key);
+  g_hash_table_remove (packages, pkg->key);
+  failed = g_list_prepend (failed, pkg);
+  n_failed++;
+}
+
+GList *
+packages_get_loaded (void)
+{
+  if (packages == NULL)
+    return NULL;
+
+  return g_hash_table_get_values (packages);
+}
+
+void
+package_reset (void)
+{
+  GList *loaded;
+
+  if (packages == NULL)
+    return;
+
+  loaded = g_hash_table_get_values (packages);
+  g_hash_table_destroy (packages);
+  packages = NULL;
+  g_list_free_full (loaded, (GDestroyNotify) package_free);
+}
+
+/* Drop the elements cleared to NULL from LIST in one pass, rather than
+ * with a g_list_remove per element, which is quadratic. */
+static GList *
+list_remove_nulls (GList *list)
+{
+  GList *iter = list;
+
+  while (iter != NULL)
+    {
+      GList *next = g_list_next (iter);
+
+      stats_add (STAT_LIST_STEPS, 1);
+      if (iter->data == NULL)
+        list = g_list_delete_link (list, iter);
+      iter = next;
+    }
+
+  return list;
+}
+
+static gboolean
 verify_info (Package *pkg)
 {
   /* Be sure we have the required fields */
@@ -228,29 +475,31 @@ verify_info (Package *pkg)
     {
       verbose_error ("Package '%s' has no Name: field\n",
                      pkg->key);
-      exit (1);
+      return FALSE;
     }
 
   if (pkg->version == NULL)
     {
       verbose_error ("Package '%s' has no Version: field\n",
                      pkg->key);
-      exit (1);
+      return FALSE;
     }
 
   if (pkg->description == NULL)
     {
       verbose_error ("Package '%s' has no Description: field\n",
                      pkg->key);
-      exit (1);
+      return FALSE;
     }
+
+  return TRUE;
 }
 
-static void
+static gboolean
 verify_req_version (Package *pkg, Package *req, RequiredVersion *ver)
 {
   if (version_test (ver->comparison, req->version, ver->version))
-    return;
+    return TRUE;
   verbose_error ("Package '%s' requires '%s %s %s' but version of %s is %s\n",
                  pkg->key, req->key,
                  comparison_to_str (ver->comparison),
@@ -260,14 +509,17 @@ verify_req_version (Package *pkg, Package *req, RequiredVersion *ver)
   if (req->url)
     verbose_error ("You may find new versions of %s at %s\n",
                    req->name, req->url);
-  exit (1);
+  return FALSE;
 }
 
-static void
+/* Load the packages PKG requires.  Returns FALSE if one is missing or
+ * cannot be loaded itself. */
+static gboolean
 load_requires (Package *pkg, gboolean warn)
 {
   GList *iter;
   GHashTable *seen = g_hash_table_new (g_str_hash, g_str_equal);
+  guint failed_before;
 
   /* Pull in Requires packages. */
   for (iter = pkg->requires_entries; iter != NULL; iter = g_list_next (iter))
@@ -275,17 +527,20 @@ load_requires (Package *pkg, gboolean warn)
       Package *req;
       RequiredVersion *ver = iter->data;
 
-      debug_spew ("Searching for '%s' requirement '%s'\n",
-                  pkg->key, ver->name);
+      debug_log (LOG_GRAPH, "Searching for '%s' requirement '%s'\n",
+                 pkg->key, ver->name);
+      failed_before = n_failed;
       req = internal_get_package (ver->name, warn);
-      if (req == NULL)
+      if (req == NULL || !verify_req_version (pkg, req, ver))
         {
-          verbose_error ("Package '%s', required by '%s', not found\n",
-                         ver->name, pkg->key);
-          exit (1);
+          /* a package that failed to load has said why */
+          if (req == NULL && n_failed == failed_before)
+            verbose_error ("Package '%s', required by '%s', not found\n",
+                           ver->name, pkg->key);
+          g_hash_table_destroy (seen);
+          return FALSE;
         }
-
-      verify_req_version (pkg, req, ver);
+      PROBE3 (requires__edge, pkg->key, ver->name, 0);
 
       g_hash_table_insert (seen, ver->name, req);
 
@@ -309,7 +564,11 @@ load_requires (Package *pkg, gboolean warn)
       if (req == NULL)
         continue;
 
-      verify_req_version (pkg, req, ver);
+      if (!verify_req_version (pkg, req, ver))
+        {
+          g_hash_table_destroy (seen);
+          return FALSE;
+        }
     }
 
   g_hash_table_destroy (seen);
@@ -322,20 +581,25 @@ load_requires (Package *pkg, gboolean warn)
       Package *req;
       RequiredVersion *ver = iter->data;
 
-      debug_spew ("Searching for '%s' private requirement '%s'\n",
-                  pkg->key, ver->name);
+      debug_log (LOG_GRAPH, "Searching for '%s' private requirement '%s'\n",
+                 pkg->key, ver->name);
+      failed_before = n_failed;
       req = internal_get_package (ver->name,
                   tolerate_missing_requires_private ? FALSE : warn);
+      if (req == NULL && n_failed != failed_before)
+        return FALSE;
       if (req == NULL)
         {
           if (tolerate_missing_requires_private)
             continue;
           verbose_error ("Package '%s', required by '%s', not found\n",
 			 ver->name, pkg->key);
-          exit (1);
+          return FALSE;
         }
 
-      verify_req_version (pkg, req, ver);
+      if (!verify_req_version (pkg, req, ver))
+        return FALSE;
+      PROBE3 (requires__edge, pkg->key, ver->name, 1);
 
       pkg->requires_private = g_list_prepend (pkg->requires_private, req);
     }
@@ -346,6 +610,8 @@ load_requires (Package *pkg, gboolean warn)
 
   pkg->requires = g_list_reverse (pkg->requires);
   pkg->requires_private = g_list_reverse (pkg->requires_private);
+
+  return TRUE;
 }
 
 static Package *
@@ -356,20 +622,31 @@ internal_get_package (const char *name, gboolean warn)
   char *location = NULL;
   unsigned int path_position = 0;
   GList *dir_iter;
+  gboolean ok;
+  gboolean parse_failed = FALSE;
   
+  stats_add (STAT_HASH_LOOKUPS, 1);
   pkg = g_hash_table_lookup (packages, name);
 
   if (pkg)
-    return pkg;
+    {
+      stats_add (STAT_CACHE_HITS, 1);
+      return pkg;
+    }
 
-  debug_spew ("Looking for package '%s'\n", name);
+  debug_log (LOG_LOOKUP, "Looking for package '%s'\n", name);
+  PROBE1 (lookup__start, name);
+  trace_begin ("get_package", name, NULL);
+  timings_push (PHASE_LOOKUP);
   
   /* treat "name" as a filename if it ends in .pc and exists */
   if ( ends_in_dotpc (name) )
     {
-      debug_spew ("Considering '%s' to be a filename rather than a package name\n", name);
+      debug_log (LOG_LOOKUP,
+                 "Considering '%s' to be a filename rather than a package name\n", name);
       location = g_strdup (name);
       key = g_strdup (name);
+      PROBE4 (lookup__end, name, NULL, location, 1);
     }
   else
     {
@@ -378,16 +655,29 @@ internal_get_package (const char *name, gboolean warn)
           !name_ends_in_uninstalled (name))
         {
           char *un;
+          guint failed_before = n_failed;
 
           un = g_strconcat (name, "-uninstalled", NULL);
 
           pkg = internal_get_package (un, FALSE);
 
           g_free (un);
+
+          /* a broken uninstalled package isn't replaced by the other */
+          if (pkg == NULL && n_failed != failed_before)
+            {
+              timings_pop ();
+              trace_end (NULL);
+              return NULL;
+            }
           
           if (pkg)
             {
-              debug_spew ("Preferring uninstalled version of package '%s'\n", name);
+              debug_log (LOG_LOOKUP,
+                         "Preferring uninstalled version of package '%s'\n", name);
+              PROBE4 (lookup__end, name, pkg->pcfiledir, NULL, 1);
+              timings_pop ();
+              trace_end (NULL);
               return pkg;
             }
         }
@@ -398,22 +688,33 @@ internal_get_package (const char *name, gboolean warn)
           path_position++;
           location = g_strdup_printf ("%s%c%s.pc", (char*)dir_iter->data,
                                       G_DIR_SEPARATOR, name);
+          stats_add (STAT_DIRS_PROBED, 1);
+          stats_add (STAT_STAT_CALLS, 1);
+          trace_begin ("probe", name, location);
           if (g_file_test (location, G_FILE_TEST_IS_REGULAR))
-            break;
+            {
+              PROBE4 (lookup__end, name, dir_iter->data, location, 1);
+              trace_end (NULL);
+              break;
+            }
+          trace_end (NULL);
           g_free (location);
           location = NULL;
         }
 
     }
+  timings_pop ();
   
   if (location == NULL)
     {
+      PROBE4 (lookup__end, name, NULL, NULL, 0);
       if (warn)
         verbose_error ("Package %s was not found in the pkg-config search path.\n"
                        "Perhaps you should add the directory containing `%s.pc'\n"
                        "to the PKG_CONFIG_PATH environment variable\n",
                        name, name);
 
+      trace_end (NULL);
       return NULL;
     }
 
@@ -426,18 +727,23 @@ internal_get_package (const char *name, gboolean warn)
       key[strlen (key) - EXT_LEN] = '\0';
     }
 
-  debug_spew ("Reading '%s' from file '%s'\n", name, location);
-  pkg = parse_package_file (key, location);
+  debug_log (LOG_LOOKUP, "Reading '%s' from file '%s'\n", name, location);
+  /* unless errors are fatal, a malformed file fails like a missing
+   * dependency, so that it is read again once it is fixed */
+  if (errors_fatal)
+    pkg = parse_package_file (key, location);
+  else
+    pkg = parse_package_file_checked (key, location, &parse_failed);
   g_free (key);
 
   if (pkg != NULL && strstr (location, "uninstalled.pc"))
     pkg->uninstalled = TRUE;
 
-  g_free (location);
-
   if (pkg == NULL)
     {
-      debug_spew ("Failed to parse '%s'\n", location);
+      debug_log (LOG_LOOKUP, "Failed to parse '%s'\n", location);
+      trace_end (location);
+      g_free (location);
       return NULL;
     }
 
@@ -445,20 +751,38 @@ internal_get_package (const char *name, gboolean warn)
 
   pkg->path_position = path_position;
 
-  debug_spew ("Path position of '%s' is %d\n",
-              pkg->key, pkg->path_position);
+  debug_log (LOG_LOOKUP, "Path position of '%s' is %d\n",
+             pkg->key, pkg->path_position);
   
-  debug_spew ("Adding '%s' to list of known packages\n", pkg->key);
+  debug_log (LOG_LOOKUP, "Adding '%s' to list of known packages\n", pkg->key);
   g_hash_table_insert (packages, pkg->key, pkg);
+  stats_add (STAT_PACKAGES_LOADED, 1);
 
-  verify_info (pkg);
+  ok = !parse_failed && verify_info (pkg);
 
+  trace_begin ("load_requires", pkg->key, NULL);
+  timings_push (PHASE_REQUIRES);
   if (!ignore_requires)
-    load_requires (pkg, warn);
+    ok = ok && load_requires (pkg, warn);
   else /* Requires ignored => Requires.private should also be ignored. */
     g_assert (ignore_requires_private);
+  timings_pop ();
+  trace_end (NULL);
+
+  trace_begin ("verify_package", pkg->key, NULL);
+  timings_push (PHASE_VERIFY);
+  ok = ok && verify_package (pkg);
+  timings_pop ();
+  trace_end (NULL);
 
-  verify_package (pkg);
+  trace_end (location);
+  g_free (location);
+
+  if (!ok)
+    {
+      package_failed (pkg);
+      return NULL;
+    }
 
   return pkg;
 }
@@ -494,7 +818,8 @@ flag_list_strip_duplicates (GList *list)
            * element to prepare for the next iteration. */
           GList *dup = tmp;
 
-          debug_spew (" removing duplicate \"%s\"\n", cur->arg);
+          debug_log (LOG_FLAGS, " removing duplicate \"%s\"\n", cur->arg);
+          stats_add (STAT_DUPLICATES_REMOVED, 1);
           tmp = g_list_previous (tmp);
           list = g_list_remove_link (list, dup);
         }
@@ -503,6 +828,32 @@ flag_list_strip_duplicates (GList *list)
   return list;
 }
 
+static void
+append_flag (GString *str, Flag *flag)
+{
+  char *tmpstr = flag->arg;
+
+  if (pcsysrootdir != NULL && flag->type & (CFLAGS_I | LIBS_L)) {
+    /* Handle non-I Cflags like -isystem */
+    if (flag->type & CFLAGS_I && strncmp (tmpstr, "-I", 2) != 0) {
+      char *space = strchr (tmpstr, ' ');
+
+      /* Ensure this has a separate arg */
+      g_assert (space != NULL && space[1] != '\0');
+      g_string_append_len (str, tmpstr, space - tmpstr + 1);
+      g_string_append (str, pcsysrootdir);
+      g_string_append (str, space + 1);
+    } else {
+      g_string_append_c (str, '-');
+      g_string_append_c (str, tmpstr[1]);
+      g_string_append (str, pcsysrootdir);
+      g_string_append (str, tmpstr+2);
+    }
+  } else {
+    g_string_append (str, tmpstr);
+  }
+}
+
 static char *
 flag_list_to_string (GList *list)
 {
@@ -512,28 +863,7 @@ flag_list_to_string (GList *list)
   
   tmp = list;
   while (tmp != NULL) {
-    Flag *flag = tmp->data;
-    char *tmpstr = flag->arg;
-
-    if (pcsysrootdir != NULL && flag->type & (CFLAGS_I | LIBS_L)) {
-      /* Handle non-I Cflags like -isystem */
-      if (flag->type & CFLAGS_I && strncmp (tmpstr, "-I", 2) != 0) {
-        char *space = strchr (tmpstr, ' ');
-
-        /* Ensure this has a separate arg */
-        g_assert (space != NULL && space[1] != '\0');
-        g_string_append_len (str, tmpstr, space - tmpstr + 1);
-        g_string_append (str, pcsysrootdir);
-        g_string_append (str, space + 1);
-      } else {
-        g_string_append_c (str, '-');
-        g_string_append_c (str, tmpstr[1]);
-        g_string_append (str, pcsysrootdir);
-        g_string_append (str, tmpstr+2);
-      }
-    } else {
-      g_string_append (str, tmpstr);
-    }
+    append_flag (str, tmp->data);
     g_string_append_c (str, ' ');
     tmp = g_list_next (tmp);
   }
@@ -564,16 +894,16 @@ spew_package_list (const char *name,
 {
   GList *tmp;
 
-  debug_spew (" %s:", name);
+  debug_log (LOG_GRAPH, " %s:", name);
 
   tmp = list;
   while (tmp != NULL)
     {
       Package *pkg = tmp->data;
-      debug_spew (" %s", pkg->key);
+      debug_log (LOG_GRAPH, " %s", pkg->key);
       tmp = tmp->next;
     }
-  debug_spew ("\n");
+  debug_log (LOG_GRAPH, "\n");
 }
 
 
@@ -604,14 +934,15 @@ recursive_fill_list (Package *pkg, gboolean include_private,
    */
   if (g_hash_table_lookup_extended (visited, pkg->key, NULL, NULL))
     {
-      debug_spew ("Package %s already in requires chain, skipping\n",
-                  pkg->key);
+      debug_log (LOG_GRAPH, "Package %s already in requires chain, skipping\n",
+                 pkg->key);
       return;
     }
   /* record this package in the dependency chain */
   else
     {
       g_hash_table_replace (visited, pkg->key, pkg->key);
+      stats_add (STAT_GRAPH_VISITS, 1);
     }
 
   /* Start from the end of the required package list to maintain order since
@@ -649,7 +980,11 @@ merge_flag_lists (GList *packages, FlagType type)
                   last = merged;
                 }
               else
-                last = g_list_next (g_list_append (last, flags->data));
+                {
+                  /* g_list_next is a macro that would append twice */
+                  last = g_list_append (last, flags->data);
+                  last = g_list_next (last);
+                }
             }
         }
     }
@@ -658,12 +993,11 @@ merge_flag_lists (GList *packages, FlagType type)
 }
 
 static GList *
-fill_list (GList *packages, FlagType type,
-           gboolean in_path_order, gboolean include_private)
+fill_package_list (GList *packages, gboolean in_path_order,
+                   gboolean include_private)
 {
   GList *tmp;
   GList *expanded = NULL;
-  GList *flags;
   GHashTable *visited;
 
   /* Start from the end of the requested package list to maintain order since
@@ -681,6 +1015,17 @@ fill_list (GList *packages, FlagType type,
       spew_package_list ("  sorted", expanded);
     }
 
+  return expanded;
+}
+
+static GList *
+fill_list (GList *packages, FlagType type,
+           gboolean in_path_order, gboolean include_private)
+{
+  GList *expanded;
+  GList *flags;
+
+  expanded = fill_package_list (packages, in_path_order, include_private);
   flags = merge_flag_lists (expanded, type);
   g_list_free (expanded);
 
@@ -722,7 +1067,44 @@ static const gchar *msvc_include_envvars[] = {
 };
 #endif
 
-static void
+/* The system include directories that compilers search anyway, from
+ * PKG_CONFIG_SYSTEM_INCLUDE_PATH and the compiler environment.  The
+ * caller frees the list and its strings. */
+GList *
+system_include_dirs (void)
+{
+  GList *system_directories = NULL;
+  const gchar *search_path;
+  const gchar **include_envvars;
+  const gchar **var;
+
+  search_path = g_getenv ("PKG_CONFIG_SYSTEM_INCLUDE_PATH");
+
+  if (search_path == NULL)
+    {
+      search_path = PKG_CONFIG_SYSTEM_INCLUDE_PATH;
+    }
+
+  system_directories = add_env_variable_to_list (system_directories, search_path);
+
+#ifdef G_OS_WIN32
+  include_envvars = msvc_syntax ? msvc_include_envvars : gcc_include_envvars;
+#else
+  include_envvars = gcc_include_envvars;
+#endif
+  for (var = include_envvars; *var != NULL; var++)
+    {
+      search_path = g_getenv (*var);
+      if (search_path != NULL)
+        system_directories = add_env_variable_to_list (system_directories, search_path);
+    }
+
+  return system_directories;
+}
+
+/* Check PKG against its Conflicts, reporting the first one found, and
+ * strip the system directories from its flags */
+static gboolean
 verify_package (Package *pkg)
 {
   GList *requires = NULL;
@@ -733,32 +1115,51 @@ verify_package (Package *pkg)
   GList *conflicts_iter;
   GList *system_dir_iter = NULL;
   GHashTable *visited;
+  GHashTable *conflicts_by_name;
+  gboolean conflict = FALSE;
   int count;
   const gchar *search_path;
-  const gchar **include_envvars;
-  const gchar **var;
 
-  /* Make sure we didn't drag in any conflicts via Requires
-   * (inefficient algorithm, who cares)
+  /* Make sure we didn't drag in any conflicts via Requires.  The
+   * Conflicts entries are grouped by name, in their original order, so
+   * that each required package is only tested against its own.  Every
+   * package is verified, so walking the closure of those without
+   * Conflicts would make a deep graph quadratic for nothing.
    */
-  visited = g_hash_table_new (g_str_hash, g_str_equal);
-  recursive_fill_list (pkg, TRUE, visited, &requires);
-  g_hash_table_destroy (visited);
-  conflicts = pkg->conflicts;
+  if (pkg->conflicts != NULL)
+    {
+      visited = g_hash_table_new (g_str_hash, g_str_equal);
+      recursive_fill_list (pkg, TRUE, visited, &requires);
+      g_hash_table_destroy (visited);
+    }
+
+  conflicts_by_name = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+                                             (GDestroyNotify) g_list_free);
+  for (iter = g_list_last (pkg->conflicts); iter != NULL;
+       iter = g_list_previous (iter))
+    {
+      RequiredVersion *ver = iter->data;
+
+      conflicts = g_hash_table_lookup (conflicts_by_name, ver->name);
+      g_hash_table_steal (conflicts_by_name, ver->name);
+      g_hash_table_insert (conflicts_by_name, ver->name,
+                           g_list_prepend (conflicts, ver));
+    }
 
   requires_iter = requires;
-  while (requires_iter != NULL)
+  while (requires_iter != NULL && !conflict)
     {
       Package *req = requires_iter->data;
       
-      conflicts_iter = conflicts;
+      conflicts_iter = g_hash_table_lookup (conflicts_by_name, req->key);
 
-      while (conflicts_iter != NULL)
+      while (conflicts_iter != NULL && !conflict)
         {
           RequiredVersion *ver = conflicts_iter->data;
 
-	  if (strcmp (ver->name, req->key) == 0 &&
-	      version_test (ver->comparison,
+          PROBE3 (conflict__check, pkg->key, ver->name, req->key);
+          stats_add (STAT_CONFLICT_CHECKS, 1);
+	  if (version_test (ver->comparison,
 			    req->version,
 			    ver->version))
             {
@@ -771,7 +1172,7 @@ verify_package (Package *pkg)
                              ver->owner->key,
                              ver->owner->version);
 
-              exit (1);
+              conflict = TRUE;
             }
 
           conflicts_iter = g_list_next (conflicts_iter);
@@ -781,31 +1182,15 @@ verify_package (Package *pkg)
     }
   
   g_list_free (requires);
+  g_hash_table_destroy (conflicts_by_name);
+  if (conflict)
+    return FALSE;
 
   /* We make a list of system directories that compilers expect so we
    * can remove them.
    */
 
-  search_path = g_getenv ("PKG_CONFIG_SYSTEM_INCLUDE_PATH");
-
-  if (search_path == NULL)
-    {
-      search_path = PKG_CONFIG_SYSTEM_INCLUDE_PATH;
-    }
-
-  system_directories = add_env_variable_to_list (system_directories, search_path);
-
-#ifdef G_OS_WIN32
-  include_envvars = msvc_syntax ? msvc_include_envvars : gcc_include_envvars;
-#else
-  include_envvars = gcc_include_envvars;
-#endif
-  for (var = include_envvars; *var != NULL; var++)
-    {
-      search_path = g_getenv (*var);
-      if (search_path != NULL)
-        system_directories = add_env_variable_to_list (system_directories, search_path);
-    }
+  system_directories = system_include_dirs ();
 
   count = 0;
   for (iter = pkg->cflags; iter != NULL; iter = g_list_next (iter))
@@ -838,12 +1223,12 @@ verify_package (Package *pkg)
 	      if (strcmp (system_dir_iter->data,
                           ((char*)flag->arg) + offset) == 0)
 		{
-                  debug_spew ("Package %s has %s in Cflags\n",
-			      pkg->key, (gchar *)flag->arg);
+                  debug_log (LOG_FLAGS, "Package %s has %s in Cflags\n",
+                             pkg->key, (gchar *)flag->arg);
 		  if (g_getenv ("PKG_CONFIG_ALLOW_SYSTEM_CFLAGS") == NULL)
 		    {
-                      debug_spew ("Removing %s from cflags for %s\n",
-                                  flag->arg, pkg->key);
+                      debug_log (LOG_FLAGS, "Removing %s from cflags for %s\n",
+                                 flag->arg, pkg->key);
 		      ++count;
 		      iter->data = NULL;
 
@@ -855,11 +1240,8 @@ verify_package (Package *pkg)
         }
     }
 
-  while (count)
-    {
-      pkg->cflags = g_list_remove (pkg->cflags, NULL);
-      --count;
-    }
+  if (count > 0)
+    pkg->cflags = list_remove_nulls (pkg->cflags);
 
   g_list_foreach (system_directories, (GFunc) g_free, NULL);
   g_list_free (system_directories);
@@ -904,14 +1286,14 @@ verify_package (Package *pkg)
             is_system = TRUE;
           if (is_system)
             {
-              debug_spew ("Package %s has -L %s in Libs\n",
-                          pkg->key, system_libpath);
+              debug_log (LOG_FLAGS, "Package %s has -L %s in Libs\n",
+                         pkg->key, system_libpath);
               if (g_getenv ("PKG_CONFIG_ALLOW_SYSTEM_LIBS") == NULL)
                 {
                   iter->data = NULL;
                   ++count;
-                  debug_spew ("Removing -L %s from libs for %s\n",
-                              system_libpath, pkg->key);
+                  debug_log (LOG_FLAGS, "Removing -L %s from libs for %s\n",
+                             system_libpath, pkg->key);
                   break;
                 }
             }
@@ -920,11 +1302,10 @@ verify_package (Package *pkg)
     }
   g_list_free (system_directories);
 
-  while (count)
-    {
-      pkg->libs = g_list_remove (pkg->libs, NULL);
-      --count;
-    }
+  if (count > 0)
+    pkg->libs = list_remove_nulls (pkg->libs);
+
+  return TRUE;
 }
 
 /* Create a merged list of required packages and retrieve the flags from them.
@@ -941,49 +1322,336 @@ get_multi_merged (GList *pkgs, FlagType type, gboolean in_path_order,
   GList *list;
   char *retval;
 
+  trace_begin ("get_multi_merged", NULL, NULL);
   list = fill_list (pkgs, type, in_path_order, include_private);
   list = flag_list_strip_duplicates (list);
   retval = flag_list_to_string (list);
   g_list_free (list);
+  trace_end (NULL);
 
   return retval;
 }
 
-char *
-packages_get_flags (GList *pkgs, FlagType flags)
+/* Output a single -I flag for an include farm merging the -I directories
+ * of the closure, or NULL if they cannot be merged (e.g. -isystem flags
+ * or conflicting file names).
+ */
+static char *
+get_include_farm (GList *pkgs)
 {
-  GString *str;
-  char *cur;
+  GList *list;
+  GList *tmp;
+  GList *dirs = NULL;
+  char *farm = NULL;
+  char *cwd;
+  gboolean ok = TRUE;
 
-  str = g_string_new (NULL);
+  list = fill_list (pkgs, CFLAGS_I, TRUE, TRUE);
+  list = flag_list_strip_duplicates (list);
 
-  /* sort packages in path order for -L/-I, dependency order otherwise */
-  if (flags & CFLAGS_OTHER)
+  cwd = g_get_current_dir ();
+  for (tmp = list; ok && tmp != NULL; tmp = g_list_next (tmp))
     {
-      cur = get_multi_merged (pkgs, CFLAGS_OTHER, FALSE, TRUE);
-      debug_spew ("adding CFLAGS_OTHER string \"%s\"\n", cur);
-      g_string_append (str, cur);
-      g_free (cur);
+      Flag *flag = tmp->data;
+      char *dir;
+      char *sysdir;
+
+      if (strncmp (flag->arg, "-I", 2) != 0)
+        {
+          debug_log (LOG_FLAGS,
+                     "Cannot put '%s' in an include farm\n", flag->arg);
+          ok = FALSE;
+          continue;
+        }
+
+      dir = g_shell_unquote (flag->arg + 2, NULL);
+      if (dir == NULL)
+        dir = g_strdup (flag->arg + 2);
+      sysdir = g_strconcat (pcsysrootdir ? pcsysrootdir : "", dir, NULL);
+      g_free (dir);
+
+      /* the farm lives elsewhere, so its links need absolute targets */
+      if (g_path_is_absolute (sysdir))
+        dirs = g_list_append (dirs, sysdir);
+      else
+        {
+          dirs = g_list_append (dirs, g_build_filename (cwd, sysdir, NULL));
+          g_free (sysdir);
+        }
     }
-  if (flags & CFLAGS_I)
+  g_list_free (list);
+  g_free (cwd);
+
+  if (ok && dirs != NULL)
     {
-      cur = get_multi_merged (pkgs, CFLAGS_I, TRUE, TRUE);
-      debug_spew ("adding CFLAGS_I string \"%s\"\n", cur);
-      g_string_append (str, cur);
-      g_free (cur);
+      char *path = include_farm_get (dirs, include_farm_dir);
+
+      if (path != NULL)
+        {
+          char *escaped = strdup_escape_shell (path);
+
+          farm = g_strconcat ("-I", escaped, " ", NULL);
+          g_free (escaped);
+          g_free (path);
+        }
     }
-  if (flags & LIBS_L)
+
+  g_list_free_full (dirs, g_free);
+
+  return farm;
+}
+
+/* Append the library directory of each LIBS_L flag in LIST to DIRS,
+ * unquoted and with the sysroot applied, skipping duplicates. */
+static GList *
+append_lib_dirs (GList *dirs, GList *list)
+{
+  for (; list != NULL; list = g_list_next (list))
     {
-      cur = get_multi_merged (pkgs, LIBS_L, TRUE, !ignore_private_libs);
-      debug_spew ("adding LIBS_L string \"%s\"\n", cur);
+      Flag *flag = list->data;
+      const char *arg;
+      char *unquoted;
+      char *dir;
+
+      if (!(flag->type & LIBS_L))
+        continue;
+
+      arg = lib_dir_from_flag (flag->arg);
+      if (arg == NULL)
+        continue;
+
+      unquoted = g_shell_unquote (arg, NULL);
+      if (unquoted == NULL)
+        unquoted = g_strdup (arg);
+      if (pcsysrootdir != NULL)
+        {
+          dir = g_strconcat (pcsysrootdir, unquoted, NULL);
+          g_free (unquoted);
+        }
+      else
+        dir = unquoted;
+
+      if (g_list_find_custom (dirs, dir, (GCompareFunc) strcmp) == NULL)
+        dirs = g_list_append (dirs, dir);
+      else
+        g_free (dir);
+    }
+
+  return dirs;
+}
+
+/* An output flag with the package it came from and, for -l flags, the
+ * library the linker would pick. */
+typedef struct
+{
+  Flag *flag;
+  Package *pkg;
+  char *path;
+} ResolvedFlag;
+
+static void
+resolved_flag_free (ResolvedFlag *rf)
+{
+  g_free (rf->path);
+  g_free (rf);
+}
+
+static void
+dir_list_free (GList *dirs)
+{
+  g_list_free_full (dirs, g_free);
+}
+
+/* Merge the flags of TYPE like get_multi_merged and resolve each -l
+ * flag.  A library is looked for in the -L directories of the package
+ * that lists it, then in the -L directories of the whole closure (which
+ * the linker would also search) and finally in the system library path.
+ * The search list is built once per package.  Flags that resolve to
+ * nothing are reported.
+ */
+static GList *
+resolve_lib_flags (GList *pkgs, FlagType type, gboolean include_private)
+{
+  GList *expanded;
+  GList *list;
+  GList *tmp;
+  GList *closure_dirs;
+  GList *retval = NULL;
+  GHashTable *owners;
+  GHashTable *search_dirs;
+
+  owners = g_hash_table_new (g_direct_hash, g_direct_equal);
+  expanded = fill_package_list (pkgs, FALSE, include_private);
+  for (tmp = expanded; tmp != NULL; tmp = g_list_next (tmp))
+    {
+      Package *pkg = tmp->data;
+      GList *iter;
+
+      for (iter = pkg->libs; iter != NULL; iter = g_list_next (iter))
+        g_hash_table_insert (owners, iter->data, pkg);
+    }
+
+  list = fill_list (pkgs, LIBS_L, TRUE, include_private);
+  list = flag_list_strip_duplicates (list);
+  closure_dirs = append_lib_dirs (NULL, list);
+  g_list_free (list);
+
+  list = merge_flag_lists (expanded, type);
+  list = flag_list_strip_duplicates (list);
+
+  search_dirs = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
+                                       (GDestroyNotify) dir_list_free);
+  for (tmp = list; tmp != NULL; tmp = g_list_next (tmp))
+    {
+      ResolvedFlag *rf = g_new0 (ResolvedFlag, 1);
+      const char *name;
+
+      rf->flag = tmp->data;
+      rf->pkg = g_hash_table_lookup (owners, rf->flag);
+      retval = g_list_prepend (retval, rf);
+
+      name = lib_name_from_flag (rf->flag->arg);
+      if (rf->flag->type & LIBS_l && name != NULL && rf->pkg != NULL)
+        {
+          GList *dirs;
+          GList *sys;
+
+          dirs = g_hash_table_lookup (search_dirs, rf->pkg);
+          if (dirs == NULL)
+            {
+              dirs = append_lib_dirs (NULL, rf->pkg->libs);
+              for (sys = closure_dirs; sys != NULL; sys = g_list_next (sys))
+                if (g_list_find_custom (dirs, sys->data,
+                                        (GCompareFunc) strcmp) == NULL)
+                  dirs = g_list_append (dirs, g_strdup (sys->data));
+              for (sys = system_library_dirs (); sys != NULL;
+                   sys = g_list_next (sys))
+                dirs = g_list_append (dirs,
+                                      g_strconcat (pcsysrootdir ?
+                                                   pcsysrootdir : "",
+                                                   sys->data, NULL));
+              g_hash_table_insert (search_dirs, rf->pkg, dirs);
+            }
+
+          rf->path = resolve_library (name, dirs, resolve_static);
+
+          if (rf->path == NULL)
+            verbose_error ("Library '%s' required by '%s' not found\n",
+                           rf->flag->arg, rf->pkg->key);
+          else
+            debug_log (LOG_FLAGS,
+                       "Resolved %s to %s\n", rf->flag->arg, rf->path);
+        }
+    }
+
+  g_hash_table_destroy (search_dirs);
+  g_list_free_full (closure_dirs, g_free);
+  g_list_free (list);
+  g_list_free (expanded);
+  g_hash_table_destroy (owners);
+
+  return g_list_reverse (retval);
+}
+
+/* Like get_multi_merged for LIBS_l | LIBS_OTHER, but each -l flag is
+ * replaced with the absolute path of the library the linker would have
+ * picked.  Flags that resolve to nothing are passed through, and
+ * UNRESOLVED is set if any -l flag was among them.
+ */
+static char *
+get_resolved_libs (GList *pkgs, FlagType type, gboolean include_private,
+                   gboolean *unresolved)
+{
+  GList *list;
+  GList *tmp;
+  GString *str;
+
+  list = resolve_lib_flags (pkgs, type, include_private);
+  *unresolved = FALSE;
+
+  str = g_string_new ("");
+  for (tmp = list; tmp != NULL; tmp = g_list_next (tmp))
+    {
+      ResolvedFlag *rf = tmp->data;
+
+      if (rf->path != NULL)
+        {
+          char *escaped = strdup_escape_shell (rf->path);
+          g_string_append (str, escaped);
+          g_free (escaped);
+        }
+      else
+        {
+          if (rf->flag->type & LIBS_l)
+            *unresolved = TRUE;
+          g_string_append (str, rf->flag->arg);
+        }
+      g_string_append_c (str, ' ');
+    }
+
+  g_list_free_full (list, (GDestroyNotify) resolved_flag_free);
+
+  return g_string_free (str, FALSE);
+}
+
+char *
+packages_get_flags (GList *pkgs, FlagType flags)
+{
+  GString *str;
+  char *cur;
+  char *resolved = NULL;
+  gboolean unresolved = FALSE;
+
+  timings_push (PHASE_MERGE);
+  str = g_string_new (NULL);
+
+  /* sort packages in path order for -L/-I, dependency order otherwise */
+  if (flags & CFLAGS_OTHER)
+    {
+      cur = get_multi_merged (pkgs, CFLAGS_OTHER, FALSE, TRUE);
+      debug_log (LOG_FLAGS, "adding CFLAGS_OTHER string \"%s\"\n", cur);
       g_string_append (str, cur);
       g_free (cur);
     }
-  if (flags & (LIBS_OTHER | LIBS_l))
+  if (flags & CFLAGS_I && include_farm_dir != NULL &&
+      (cur = get_include_farm (pkgs)) != NULL)
+    {
+      debug_log (LOG_FLAGS, "adding include farm string \"%s\"\n", cur);
+      g_string_append (str, cur);
+      g_free (cur);
+    }
+  else if (flags & CFLAGS_I)
+    {
+      cur = get_multi_merged (pkgs, CFLAGS_I, TRUE, TRUE);
+      debug_log (LOG_FLAGS, "adding CFLAGS_I string \"%s\"\n", cur);
+      g_string_append (str, cur);
+      g_free (cur);
+    }
+  /* Resolve first: -L flags are only needed for the -l flags that
+   * could not be resolved to a file. */
+  if (flags & (LIBS_OTHER | LIBS_l) && resolve_libs)
+    resolved = get_resolved_libs (pkgs, flags & (LIBS_OTHER | LIBS_l),
+                                  !ignore_private_libs, &unresolved);
+  if (flags & LIBS_L && (!resolve_libs || unresolved))
+    {
+      cur = get_multi_merged (pkgs, LIBS_L, TRUE, !ignore_private_libs);
+      debug_log (LOG_FLAGS, "adding LIBS_L string \"%s\"\n", cur);
+      g_string_append (str, cur);
+      g_free (cur);
+    }
+  if (resolved != NULL)
+    {
+      debug_log (LOG_FLAGS,
+                 "adding resolved LIBS_OTHER | LIBS_l string \"%s\"\n",
+                 resolved);
+      g_string_append (str, resolved);
+      g_free (resolved);
+    }
+  else if (flags & (LIBS_OTHER | LIBS_l))
     {
       cur = get_multi_merged (pkgs, flags & (LIBS_OTHER | LIBS_l), FALSE,
                               !ignore_private_libs);
-      debug_spew ("adding LIBS_OTHER | LIBS_l string \"%s\"\n", cur);
+      debug_log (LOG_FLAGS, "adding LIBS_OTHER | LIBS_l string \"%s\"\n", cur);
       g_string_append (str, cur);
       g_free (cur);
     }
@@ -992,10 +1660,666 @@ packages_get_flags (GList *pkgs, FlagType flags)
   if (str->len > 0 && str->str[str->len - 1] == ' ')
     g_string_truncate (str, str->len - 1);
 
-  debug_spew ("returning flags string \"%s\"\n", str->str);
+  debug_log (LOG_FLAGS, "returning flags string \"%s\"\n", str->str);
+  PROBE3 (flags__emit, flags, str->len, str->str);
+  timings_pop ();
   return g_string_free (str, FALSE);
 }
 
+/* How a package was pulled into the closure, for --explain. */
+typedef struct
+{
+  Package *parent;
+  gboolean private;
+} ExplainEdge;
+
+/* Record the shortest Requires/Requires.private path from the requested
+ * packages to each package of the closure.  Requested packages map to
+ * an edge without a parent. */
+static GHashTable *
+explain_edges (GList *pkgs, gboolean include_private)
+{
+  GHashTable *edges;
+  GQueue queue = G_QUEUE_INIT;
+  GList *tmp;
+
+  edges = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_free);
+  for (tmp = pkgs; tmp != NULL; tmp = g_list_next (tmp))
+    {
+      Package *pkg = tmp->data;
+
+      if (g_hash_table_contains (edges, pkg->key))
+        continue;
+      g_hash_table_insert (edges, pkg->key, g_new0 (ExplainEdge, 1));
+      g_queue_push_tail (&queue, pkg);
+    }
+
+  while (!g_queue_is_empty (&queue))
+    {
+      Package *pkg = g_queue_pop_head (&queue);
+      GList *reqs = include_private ? pkg->requires_private : pkg->requires;
+
+      for (tmp = reqs; tmp != NULL; tmp = g_list_next (tmp))
+        {
+          Package *req = tmp->data;
+          ExplainEdge *edge;
+
+          if (g_hash_table_contains (edges, req->key))
+            continue;
+
+          edge = g_new0 (ExplainEdge, 1);
+          edge->parent = pkg;
+          edge->private = g_list_find (pkg->requires, req) == NULL;
+          g_hash_table_insert (edges, req->key, edge);
+          g_queue_push_tail (&queue, req);
+        }
+    }
+
+  return edges;
+}
+
+static void
+append_explain_path (GString *str, GHashTable *edges, Package *pkg)
+{
+  ExplainEdge *edge = g_hash_table_lookup (edges, pkg->key);
+
+  while (edge != NULL && edge->parent != NULL)
+    {
+      g_string_append_printf (str, " <- %s (%s)", edge->parent->key,
+                              edge->private ? "Requires.private"
+                                            : "Requires");
+      edge = g_hash_table_lookup (edges, edge->parent->key);
+    }
+}
+
+static int
+explain_count_cmp (gconstpointer a, gconstpointer b, gpointer data)
+{
+  GHashTable *counts = data;
+  const Package *pa = a;
+  const Package *pb = b;
+  int ca = GPOINTER_TO_INT (g_hash_table_lookup (counts, pa->key));
+  int cb = GPOINTER_TO_INT (g_hash_table_lookup (counts, pb->key));
+
+  if (ca != cb)
+    return cb - ca;
+  return strcmp (pa->key, pb->key);
+}
+
+/* Append one line per flag of TYPE, in output order, naming the package
+ * it came from and the dependency path that pulled the package in. */
+static void
+explain_flags (GString *str, GList *pkgs, FlagType type,
+               gboolean in_path_order, gboolean include_private,
+               GHashTable *counts)
+{
+  GList *expanded;
+  GList *list;
+  GList *tmp;
+  GHashTable *owners;
+  GHashTable *edges;
+
+  owners = g_hash_table_new (g_direct_hash, g_direct_equal);
+  expanded = fill_package_list (pkgs, FALSE, include_private);
+  for (tmp = expanded; tmp != NULL; tmp = g_list_next (tmp))
+    {
+      Package *pkg = tmp->data;
+      GList *iter = (type & LIBS_ANY) ? pkg->libs : pkg->cflags;
+
+      for (; iter != NULL; iter = g_list_next (iter))
+        g_hash_table_insert (owners, iter->data, pkg);
+    }
+  g_list_free (expanded);
+
+  edges = explain_edges (pkgs, include_private);
+  list = fill_list (pkgs, type, in_path_order, include_private);
+  list = flag_list_strip_duplicates (list);
+
+  for (tmp = list; tmp != NULL; tmp = g_list_next (tmp))
+    {
+      Flag *flag = tmp->data;
+      Package *pkg = g_hash_table_lookup (owners, flag);
+
+      append_flag (str, flag);
+      g_string_append_c (str, '\t');
+      g_string_append (str, pkg->key);
+
+      g_hash_table_insert (counts, pkg->key,
+                           GINT_TO_POINTER (GPOINTER_TO_INT (
+                             g_hash_table_lookup (counts, pkg->key)) + 1));
+
+      append_explain_path (str, edges, pkg);
+      g_string_append_c (str, '\n');
+    }
+
+  g_list_free (list);
+  g_hash_table_destroy (edges);
+  g_hash_table_destroy (owners);
+}
+
+char *
+packages_explain_flags (GList *pkgs, FlagType flags)
+{
+  GString *str;
+  GHashTable *counts;
+  GList *contributors;
+  GList *tmp;
+
+  str = g_string_new (NULL);
+  counts = g_hash_table_new (g_str_hash, g_str_equal);
+
+  /* same sections and ordering as packages_get_flags */
+  if (flags & CFLAGS_OTHER)
+    explain_flags (str, pkgs, CFLAGS_OTHER, FALSE, TRUE, counts);
+  if (flags & CFLAGS_I)
+    explain_flags (str, pkgs, CFLAGS_I, TRUE, TRUE, counts);
+  if (flags & LIBS_L)
+    explain_flags (str, pkgs, LIBS_L, TRUE, !ignore_private_libs, counts);
+  if (flags & (LIBS_OTHER | LIBS_l))
+    explain_flags (str, pkgs, flags & (LIBS_OTHER | LIBS_l), FALSE,
+                   !ignore_private_libs, counts);
+
+  /* Summary of the packages contributing the most flags */
+  contributors = fill_package_list (pkgs, FALSE, TRUE);
+  contributors = g_list_sort_with_data (contributors, explain_count_cmp,
+                                        counts);
+  g_string_append (str, "\nFlags per package:\n");
+  for (tmp = contributors; tmp != NULL; tmp = g_list_next (tmp))
+    {
+      Package *pkg = tmp->data;
+      int count = GPOINTER_TO_INT (g_hash_table_lookup (counts, pkg->key));
+
+      if (count > 0)
+        g_string_append_printf (str, "%6d %s\n", count, pkg->key);
+    }
+  g_list_free (contributors);
+  g_hash_table_destroy (counts);
+
+  return g_string_free (str, FALSE);
+}
+
+/* Report the -l flags of the closure whose libraries define none of the
+ * symbols that OBJECTS need.  Returns FALSE if there are any, or if the
+ * objects cannot be read.
+ */
+gboolean
+packages_check_overlinking (GList *pkgs, char **objects)
+{
+  GHashTable *needed;
+  GHashTable *edges;
+  GList *list;
+  GList *tmp;
+  gboolean retval = TRUE;
+
+  needed = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  for (; *objects != NULL; objects++)
+    if (!elf_read_symbols (*objects, FALSE, needed))
+      {
+        verbose_error ("Cannot read symbols from '%s'\n", *objects);
+        g_hash_table_destroy (needed);
+        return FALSE;
+      }
+  debug_log (LOG_FLAGS, "%u undefined symbols in objects\n",
+             g_hash_table_size (needed));
+
+  edges = explain_edges (pkgs, !ignore_private_libs);
+  list = resolve_lib_flags (pkgs, LIBS_l, !ignore_private_libs);
+  for (tmp = list; tmp != NULL; tmp = g_list_next (tmp))
+    {
+      ResolvedFlag *rf = tmp->data;
+      GHashTable *defined;
+      GHashTableIter iter;
+      gpointer sym;
+      gboolean used = FALSE;
+
+      if (rf->path == NULL)
+        continue;
+
+      defined = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+      if (!elf_read_symbols (rf->path, TRUE, defined))
+        {
+          /* e.g. a linker script */
+          debug_log (LOG_FLAGS, "Not checking %s\n", rf->path);
+          g_hash_table_destroy (defined);
+          continue;
+        }
+
+      g_hash_table_iter_init (&iter, needed);
+      while (!used && g_hash_table_iter_next (&iter, &sym, NULL))
+        used = g_hash_table_contains (defined, sym);
+      g_hash_table_destroy (defined);
+
+      if (!used)
+        {
+          GString *str = g_string_new (NULL);
+
+          g_string_append_printf (str, "%s\t%s\t%s", rf->flag->arg,
+                                  rf->path, rf->pkg->key);
+          append_explain_path (str, edges, rf->pkg);
+          printf ("%s\n", str->str);
+          g_string_free (str, TRUE);
+          retval = FALSE;
+        }
+    }
+
+  g_list_free_full (list, (GDestroyNotify) resolved_flag_free);
+  g_hash_table_destroy (edges);
+  g_hash_table_destroy (needed);
+
+  return retval;
+}
+
+/* Length of the longest Requires chain starting at PKG, counting PKG.
+ * DEPTHS caches the result per package; a package in a requires loop
+ * counts as a leaf when it is reached again. */
+static int
+closure_depth (Package *pkg, gboolean include_private, GHashTable *depths)
+{
+  GList *tmp;
+  gpointer cached;
+  int depth = 0;
+
+  if (g_hash_table_lookup_extended (depths, pkg->key, NULL, &cached))
+    return GPOINTER_TO_INT (cached);
+
+  g_hash_table_insert (depths, pkg->key, GINT_TO_POINTER (1));
+  tmp = include_private ? pkg->requires_private : pkg->requires;
+  for (; tmp != NULL; tmp = g_list_next (tmp))
+    depth = MAX (depth, closure_depth (tmp->data, include_private, depths));
+  g_hash_table_insert (depths, pkg->key, GINT_TO_POINTER (depth + 1));
+
+  return depth + 1;
+}
+
+typedef struct
+{
+  Package *pkg;
+  int subtree;
+  int fanout;
+  int flags;
+} ClosureEntry;
+
+static int
+closure_entry_cmp (gconstpointer a, gconstpointer b)
+{
+  const ClosureEntry *ea = a;
+  const ClosureEntry *eb = b;
+
+  if (ea->subtree != eb->subtree)
+    return eb->subtree - ea->subtree;
+  return strcmp (ea->pkg->key, eb->pkg->key);
+}
+
+static const struct
+{
+  FlagType type;
+  const char *name;
+} closure_flag_classes[] = {
+  { CFLAGS_OTHER, "cflags-other" },
+  { CFLAGS_I, "cflags-I" },
+  { LIBS_L, "libs-L" },
+  { LIBS_l, "libs-l" },
+  { LIBS_OTHER, "libs-other" },
+};
+
+/* Count the flags of TYPE in the closure before and after duplicates
+ * are stripped, merged into one list the same way packages_get_flags
+ * merges them, and add the bytes they take in its output, with a
+ * separator each, to BYTESP.  A line is printed for each class of
+ * flags in TYPE, and LIBSP is set to the number of -l flags left. */
+static void
+closure_count_flags (GString *str, GList *pkgs, FlagType type,
+                     gboolean in_path_order, gboolean include_private,
+                     int *libsp, int *bytesp)
+{
+  GList *list;
+  GList *tmp;
+  GString *arg = g_string_new (NULL);
+  int total[G_N_ELEMENTS (closure_flag_classes)] = { 0 };
+  int unique[G_N_ELEMENTS (closure_flag_classes)] = { 0 };
+  guint i;
+
+  list = fill_list (pkgs, type, in_path_order, include_private);
+  for (tmp = list; tmp != NULL; tmp = g_list_next (tmp))
+    for (i = 0; i < G_N_ELEMENTS (closure_flag_classes); i++)
+      if (((Flag *) tmp->data)->type & closure_flag_classes[i].type)
+        total[i]++;
+  list = flag_list_strip_duplicates (list);
+  for (tmp = list; tmp != NULL; tmp = g_list_next (tmp))
+    {
+      for (i = 0; i < G_N_ELEMENTS (closure_flag_classes); i++)
+        if (((Flag *) tmp->data)->type & closure_flag_classes[i].type)
+          unique[i]++;
+      g_string_truncate (arg, 0);
+      append_flag (arg, tmp->data);
+      *bytesp += arg->len + 1;
+    }
+  g_list_free (list);
+  g_string_free (arg, TRUE);
+
+  for (i = 0; i < G_N_ELEMENTS (closure_flag_classes); i++)
+    {
+      if (!(type & closure_flag_classes[i].type))
+        continue;
+      g_string_append_printf (str, "%-12s %6d %6d\n",
+                              closure_flag_classes[i].name, total[i],
+                              unique[i]);
+      if (closure_flag_classes[i].type == LIBS_l && libsp != NULL)
+        *libsp = unique[i];
+    }
+}
+
+/* Counting the subtree of every package of a closure at once.  The
+ * subtrees are bit sets over the closure, computed in post-order from
+ * those of the packages required, so each edge is followed once.
+ * Packages requiring each other are found with Tarjan's algorithm and
+ * share their subtree. */
+typedef struct
+{
+  GHashTable *positions;        /* Package to its index + 1 */
+  Package **pkgs;
+  int words;                    /* guint32 per bit set */
+  int *order;                   /* visit number, 0 if not visited yet */
+  int *low;
+  int *stack;
+  int *stack_pos;               /* -1 when not on the stack */
+  int sp;
+  int counter;
+  guint32 **subtree;
+  GPtrArray *sets;
+} SubtreeWalk;
+
+static int
+subtree_index (SubtreeWalk *walk, Package *pkg)
+{
+  return GPOINTER_TO_INT (g_hash_table_lookup (walk->positions, pkg)) - 1;
+}
+
+static void
+subtree_visit (SubtreeWalk *walk, int v)
+{
+  GList *tmp;
+  guint32 *set;
+  int start;
+  int i;
+
+  walk->order[v] = walk->low[v] = ++walk->counter;
+  walk->stack_pos[v] = walk->sp;
+  walk->stack[walk->sp++] = v;
+
+  for (tmp = walk->pkgs[v]->requires_private; tmp != NULL;
+       tmp = g_list_next (tmp))
+    {
+      int u = subtree_index (walk, tmp->data);
+
+      if (walk->order[u] == 0)
+        {
+          subtree_visit (walk, u);
+          walk->low[v] = MIN (walk->low[v], walk->low[u]);
+        }
+      else if (walk->stack_pos[u] >= 0)
+        walk->low[v] = MIN (walk->low[v], walk->order[u]);
+    }
+
+  if (walk->low[v] != walk->order[v])
+    return;
+
+  /* V and the packages above it on the stack require each other */
+  set = g_new0 (guint32, walk->words);
+  g_ptr_array_add (walk->sets, set);
+  start = walk->stack_pos[v];
+  for (i = start; i < walk->sp; i++)
+    {
+      int u = walk->stack[i];
+
+      set[u / 32] |= 1u << (u % 32);
+      walk->subtree[u] = set;
+      walk->stack_pos[u] = -1;
+    }
+  for (i = start; i < walk->sp; i++)
+    for (tmp = walk->pkgs[walk->stack[i]]->requires_private; tmp != NULL;
+         tmp = g_list_next (tmp))
+      {
+        guint32 *other = walk->subtree[subtree_index (walk, tmp->data)];
+        int w;
+
+        if (other != set)
+          for (w = 0; w < walk->words; w++)
+            set[w] |= other[w];
+      }
+  walk->sp = start;
+}
+
+/* Set the subtree of each of the N_PACKAGES ENTRIES */
+static void
+closure_count_subtrees (ClosureEntry *entries, int n_packages)
+{
+  SubtreeWalk walk;
+  int i;
+
+  walk.positions = g_hash_table_new (NULL, NULL);
+  walk.pkgs = g_new (Package *, n_packages);
+  for (i = 0; i < n_packages; i++)
+    {
+      walk.pkgs[i] = entries[i].pkg;
+      g_hash_table_insert (walk.positions, entries[i].pkg,
+                           GINT_TO_POINTER (i + 1));
+    }
+  walk.words = (n_packages + 31) / 32;
+  walk.order = g_new0 (int, n_packages);
+  walk.low = g_new0 (int, n_packages);
+  walk.stack = g_new (int, n_packages);
+  walk.stack_pos = g_new (int, n_packages);
+  for (i = 0; i < n_packages; i++)
+    walk.stack_pos[i] = -1;
+  walk.sp = 0;
+  walk.counter = 0;
+  walk.subtree = g_new0 (guint32 *, n_packages);
+  walk.sets = g_ptr_array_new_with_free_func (g_free);
+
+  for (i = 0; i < n_packages; i++)
+    if (walk.order[i] == 0)
+      subtree_visit (&walk, i);
+
+  for (i = 0; i < n_packages; i++)
+    {
+      int w;
+
+      entries[i].subtree = 0;
+      for (w = 0; w < walk.words; w++)
+        {
+          guint32 bits = walk.subtree[i][w];
+
+          for (; bits != 0; bits &= bits - 1)
+            entries[i].subtree++;
+        }
+    }
+
+  g_ptr_array_free (walk.sets, TRUE);
+  g_free (walk.subtree);
+  g_free (walk.stack_pos);
+  g_free (walk.stack);
+  g_free (walk.low);
+  g_free (walk.order);
+  g_free (walk.pkgs);
+  g_hash_table_destroy (walk.positions);
+}
+
+/* Print statistics about the dependency closure of PKGS if PRINT, and
+ * check it against the budgets that are nonzero.  Returns FALSE if any
+ * budget is exceeded.
+ */
+gboolean
+packages_closure_stats (GList *pkgs, gboolean print, int max_packages,
+                        int max_libs, int max_output_bytes)
+{
+  GString *str;
+  GList *closure;
+  GList *tmp;
+  GHashTable *depths;
+  ClosureEntry *entries;
+  int cflags_bytes = 0;
+  int libs_bytes = 0;
+  int n_packages;
+  int n_libs = 0;
+  int depth = 0;
+  int output_bytes;
+  int i;
+  gboolean retval = TRUE;
+
+  str = g_string_new (NULL);
+
+  /* --cflags follows Requires.private, so this is the largest closure */
+  closure = fill_package_list (pkgs, FALSE, TRUE);
+  n_packages = g_list_length (closure);
+
+  depths = g_hash_table_new (g_str_hash, g_str_equal);
+  for (tmp = pkgs; tmp != NULL; tmp = g_list_next (tmp))
+    depth = MAX (depth, closure_depth (tmp->data, TRUE, depths));
+  g_hash_table_destroy (depths);
+
+  g_string_append_printf (str, "Packages: %d\n", n_packages);
+  g_string_append_printf (str, "Depth: %d\n", depth);
+
+  g_string_append_printf (str, "%-12s %6s %6s\n", "Flags:", "total", "unique");
+  closure_count_flags (str, pkgs, CFLAGS_OTHER, FALSE, TRUE, NULL,
+                       &cflags_bytes);
+  closure_count_flags (str, pkgs, CFLAGS_I, TRUE, TRUE, NULL, &cflags_bytes);
+  closure_count_flags (str, pkgs, LIBS_L, TRUE, !ignore_private_libs, NULL,
+                       &libs_bytes);
+  /* -l and other libs flags are merged into one list in the output */
+  closure_count_flags (str, pkgs, LIBS_l | LIBS_OTHER, FALSE,
+                       !ignore_private_libs, &n_libs, &libs_bytes);
+
+  /* without the separator after the last flag, as in the output; this
+   * leaves out what --include-farm and --libs-resolved would change,
+   * as they would have to do their work to know */
+  cflags_bytes = MAX (cflags_bytes - 1, 0);
+  libs_bytes = MAX (libs_bytes - 1, 0);
+  output_bytes = cflags_bytes + libs_bytes;
+  g_string_append_printf (str, "Output bytes: %d (cflags %d, libs %d)\n",
+                          output_bytes, cflags_bytes, libs_bytes);
+
+  /* Heaviest subtrees first */
+  entries = g_new0 (ClosureEntry, n_packages);
+  for (tmp = closure, i = 0; tmp != NULL; tmp = g_list_next (tmp), i++)
+    {
+      Package *pkg = tmp->data;
+
+      entries[i].pkg = pkg;
+      entries[i].fanout = g_list_length (pkg->requires_private);
+      entries[i].flags = g_list_length (pkg->cflags) +
+        g_list_length (pkg->libs);
+    }
+  closure_count_subtrees (entries, n_packages);
+  qsort (entries, n_packages, sizeof (ClosureEntry), closure_entry_cmp);
+
+  g_string_append_printf (str, "%7s %7s %6s %s\n", "Subtree", "Fan-out",
+                          "Flags", "Package");
+  for (i = 0; i < n_packages; i++)
+    g_string_append_printf (str, "%7d %7d %6d %s\n", entries[i].subtree,
+                            entries[i].fanout, entries[i].flags,
+                            entries[i].pkg->key);
+  g_free (entries);
+  g_list_free (closure);
+
+  if (print)
+    printf ("%s", str->str);
+  g_string_free (str, TRUE);
+
+  if (max_packages > 0 && n_packages > max_packages)
+    {
+      verbose_error ("Closure has %d packages, budget is %d\n",
+                     n_packages, max_packages);
+      retval = FALSE;
+    }
+  if (max_libs > 0 && n_libs > max_libs)
+    {
+      verbose_error ("Closure has %d -l flags, budget is %d\n",
+                     n_libs, max_libs);
+      retval = FALSE;
+    }
+  if (max_output_bytes > 0 && output_bytes > max_output_bytes)
+    {
+      verbose_error ("Closure flags take %d bytes, budget is %d\n",
+                     output_bytes, max_output_bytes);
+      retval = FALSE;
+    }
+
+  return retval;
+}
+
+typedef struct
+{
+  Package *pkg;
+  int level;
+} BuildLevelEntry;
+
+static int
+build_level_entry_cmp (const void *a, const void *b)
+{
+  const BuildLevelEntry *x = a;
+  const BuildLevelEntry *y = b;
+
+  if (x->level != y->level)
+    return x->level - y->level;
+
+  return strcmp (x->pkg->key, y->pkg->key);
+}
+
+/* Print the closure of PKGS, following Requires and Requires.private,
+ * in levels that can be built in parallel: level 0 has no
+ * dependencies, and the rest only depend on lower levels.  Uninstalled
+ * packages are marked with a '*' after their name, without the
+ * -uninstalled suffix.  Then print the length of the critical path,
+ * the number of levels.
+ */
+void
+packages_print_build_levels (GList *pkgs)
+{
+  GList *closure;
+  GList *tmp;
+  GHashTable *depths;
+  BuildLevelEntry *entries;
+  int n_packages;
+  int n_levels = 0;
+  int i;
+
+  closure = fill_package_list (pkgs, FALSE, TRUE);
+  n_packages = g_list_length (closure);
+
+  /* The level is the longest chain of dependencies below a package */
+  depths = g_hash_table_new (g_str_hash, g_str_equal);
+  entries = g_new0 (BuildLevelEntry, MAX (n_packages, 1));
+  for (tmp = closure, i = 0; tmp != NULL; tmp = g_list_next (tmp), i++)
+    {
+      entries[i].pkg = tmp->data;
+      entries[i].level = closure_depth (tmp->data, TRUE, depths) - 1;
+      n_levels = MAX (n_levels, entries[i].level + 1);
+    }
+  g_hash_table_destroy (depths);
+  qsort (entries, n_packages, sizeof (BuildLevelEntry),
+         build_level_entry_cmp);
+
+  for (i = 0; i < n_packages; i++)
+    {
+      Package *pkg = entries[i].pkg;
+      int len = strlen (pkg->key);
+
+      if (i == 0 || entries[i - 1].level != entries[i].level)
+        printf ("%s%d:", i > 0 ? "\n" : "", entries[i].level);
+      if (pkg->uninstalled && name_ends_in_uninstalled (pkg->key))
+        len -= strlen ("-uninstalled");
+      printf (" %.*s%s", len, pkg->key, pkg->uninstalled ? "*" : "");
+    }
+  if (n_packages > 0)
+    printf ("\n");
+  printf ("Critical path: %d\n", n_levels);
+
+  g_free (entries);
+  g_list_free (closure);
+}
+
 void
 define_global_variable (const char *varname,
                         const char *varval)
@@ -1011,8 +2335,8 @@ define_global_variable (const char *varname,
   
   g_hash_table_insert (globals, g_strdup (varname), g_strdup (varval));
       
-  debug_spew ("Global variable definition '%s' = '%s'\n",
-              varname, varval);
+  debug_log (LOG_PARSE, "Global variable definition '%s' = '%s'\n",
+             varname, varval);
 }
 
 char *
@@ -1040,7 +2364,10 @@ package_get_var (Package *pkg,
   char *varval = NULL;
 
   if (globals)
-    varval = g_strdup (g_hash_table_lookup (globals, var));
+    {
+      stats_add (STAT_HASH_LOOKUPS, 1);
+      varval = g_strdup (g_hash_table_lookup (globals, var));
+    }
 
   /* Allow overriding specific variables using an environment variable of the
    * form PKG_CONFIG_$PACKAGENAME_$VARIABLE
@@ -1052,14 +2379,18 @@ package_get_var (Package *pkg,
       g_free (env_var);
       if (env_var_content)
         {
-          debug_spew ("Overriding variable '%s' from environment\n", var);
+          debug_log (LOG_PARSE,
+                     "Overriding variable '%s' from environment\n", var);
           return g_strdup (env_var_content);
         }
     }
 
 
   if (varval == NULL && pkg->vars)
-    varval = g_strdup (g_hash_table_lookup (pkg->vars, var));
+    {
+      stats_add (STAT_HASH_LOOKUPS, 1);
+      varval = g_strdup (g_hash_table_lookup (pkg->vars, var));
+    }
 
   return varval;
 }
@@ -1097,6 +2428,7 @@ packages_get_var (GList      *pkgs,
 int
 compare_versions (const char * a, const char *b)
 {
+  stats_add (STAT_VERSION_COMPARISONS, 1);
   return rpmvercmp (a, b);
 }
 
@@ -1218,6 +2550,330 @@ print_package_list (void)
   g_hash_table_foreach (packages, packages_foreach, GINT_TO_POINTER (mlen + 1));
 }
 
+/* A package that requires another one directly, for --print-rdepends. */
+typedef struct
+{
+  const char *key;
+  gboolean private;
+} RdependsEdge;
+
+static int
+rdepends_edge_cmp (gconstpointer a, gconstpointer b)
+{
+  const RdependsEdge *ea = a;
+  const RdependsEdge *eb = b;
+
+  return strcmp (ea->key, eb->key);
+}
+
+static void
+rdepends_add (GHashTable *rdeps, const char *name, const char *key,
+              gboolean private)
+{
+  RdependsEdge *edge = g_new (RdependsEdge, 1);
+  GList *list = g_hash_table_lookup (rdeps, name);
+
+  edge->key = key;
+  edge->private = private;
+  g_hash_table_insert (rdeps, (char *) name, g_list_prepend (list, edge));
+}
+
+/* --define-variable changes the flags and the Requires, so it selects
+ * another index */
+static char *
+index_variant (void)
+{
+  GList *names;
+  GList *tmp;
+  GString *variant;
+
+  variant = g_string_new (NULL);
+  names = g_list_sort (g_hash_table_get_keys (globals), (GCompareFunc) strcmp);
+  for (tmp = names; tmp != NULL; tmp = g_list_next (tmp))
+    g_string_append_printf (variant, "%s=%s\n", (char *) tmp->data,
+                            (char *) g_hash_table_lookup (globals, tmp->data));
+  g_list_free (names);
+
+  return g_string_free (variant, FALSE);
+}
+
+/* Print every package in the search path that requires NAME, directly
+ * or through other packages, nearest first, with the chain of Requires
+ * leading to NAME. */
+gboolean
+print_rdepends (const char *name)
+{
+  GHashTable *index;
+  GHashTable *rdeps;
+  GHashTable *next;
+  GHashTableIter iter;
+  gpointer value;
+  GQueue queue = G_QUEUE_INIT;
+  GList *order = NULL;
+  GList *tmp;
+  char *variant;
+  gboolean found;
+
+  variant = index_variant ();
+  index = requires_index_load (search_dirs, variant);
+  g_free (variant);
+
+  /* invert the index */
+  rdeps = g_hash_table_new (g_str_hash, g_str_equal);
+  g_hash_table_iter_init (&iter, index);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    {
+      IndexEntry *entry = value;
+
+      for (tmp = entry->requires; tmp != NULL; tmp = g_list_next (tmp))
+        rdepends_add (rdeps, tmp->data, entry->key, FALSE);
+      for (tmp = entry->requires_private; tmp != NULL; tmp = g_list_next (tmp))
+        rdepends_add (rdeps, tmp->data, entry->key, TRUE);
+    }
+
+  /* Walk breadth first, recording for each dependent the package it
+   * requires on the way to NAME. */
+  next = g_hash_table_new (g_str_hash, g_str_equal);
+  g_hash_table_insert (next, (char *) name, NULL);
+  g_queue_push_tail (&queue, (char *) name);
+  while (!g_queue_is_empty (&queue))
+    {
+      const char *cur = g_queue_pop_head (&queue);
+      GList *list = g_hash_table_lookup (rdeps, cur);
+
+      list = g_list_sort (list, rdepends_edge_cmp);
+      g_hash_table_insert (rdeps, (char *) cur, list);
+
+      for (tmp = list; tmp != NULL; tmp = g_list_next (tmp))
+        {
+          RdependsEdge *edge = tmp->data;
+          RdependsEdge *via;
+
+          if (g_hash_table_contains (next, edge->key))
+            continue;
+
+          via = g_new (RdependsEdge, 1);
+          via->key = cur;
+          via->private = edge->private;
+          g_hash_table_insert (next, (char *) edge->key, via);
+          g_queue_push_tail (&queue, (char *) edge->key);
+          order = g_list_prepend (order, (char *) edge->key);
+        }
+    }
+  order = g_list_reverse (order);
+
+  for (tmp = order; tmp != NULL; tmp = g_list_next (tmp))
+    {
+      const char *key = tmp->data;
+      RdependsEdge *via;
+
+      printf ("%s", key);
+      while ((via = g_hash_table_lookup (next, key)) != NULL)
+        {
+          printf (" -> %s (%s)", via->key,
+                  via->private ? "Requires.private" : "Requires");
+          key = via->key;
+        }
+      printf ("\n");
+    }
+
+  found = order != NULL || g_hash_table_contains (index, name);
+  if (!found)
+    verbose_error ("No package '%s' found\n", name);
+
+  g_hash_table_iter_init (&iter, next);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    g_free (value);
+  g_hash_table_destroy (next);
+  g_list_free (order);
+  g_hash_table_iter_init (&iter, rdeps);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    g_list_free_full (value, g_free);
+  g_hash_table_destroy (rdeps);
+  g_hash_table_destroy (index);
+
+  return found;
+}
+
+/* Print the package providing the header or library QUERY. */
+gboolean
+print_which_provides (const char *query)
+{
+  GMappedFile *index;
+  char *variant;
+  char *key = NULL;
+
+  variant = index_variant ();
+  index = provider_index_open (search_dirs, variant);
+  g_free (variant);
+
+  if (index != NULL)
+    {
+      key = provider_index_lookup (index, query);
+      g_mapped_file_unref (index);
+    }
+
+  if (key == NULL)
+    {
+      verbose_error ("No package provides '%s'\n", query);
+      return FALSE;
+    }
+
+  printf ("%s\n", key);
+  g_free (key);
+
+  return TRUE;
+}
+
+/* Add the packages reachable from KEY through Requires and
+ * Requires.private in INDEX to REACHED. */
+static void
+requires_index_reach (GHashTable *index, const char *key, GHashTable *reached)
+{
+  IndexEntry *entry = g_hash_table_lookup (index, key);
+  GList *tmp;
+
+  if (entry == NULL)
+    return;
+
+  for (tmp = entry->requires; tmp != NULL; tmp = g_list_next (tmp))
+    if (!g_hash_table_contains (reached, tmp->data))
+      {
+        g_hash_table_add (reached, tmp->data);
+        requires_index_reach (index, tmp->data, reached);
+      }
+  for (tmp = entry->requires_private; tmp != NULL; tmp = g_list_next (tmp))
+    if (!g_hash_table_contains (reached, tmp->data))
+      {
+        g_hash_table_add (reached, tmp->data);
+        requires_index_reach (index, tmp->data, reached);
+      }
+}
+
+/* Print the packages providing the headers that PKG's own headers
+ * include, leaving out the ones that are already required by another
+ * of them.  This is what a cpp.req-style generator would derive. */
+void
+print_include_requires (Package *pkg)
+{
+  GList *dirs = NULL;
+  GList *includes;
+  GList *providers = NULL;
+  GList *tmp;
+  GList *iter;
+  GHashTable *seen;
+  GHashTable *index;
+  GMappedFile *provider_index;
+  char *variant;
+
+  for (tmp = pkg->cflags; tmp != NULL; tmp = g_list_next (tmp))
+    {
+      Flag *flag = tmp->data;
+      char *dir;
+
+      if (!(flag->type & CFLAGS_I) || strncmp (flag->arg, "-I", 2) != 0)
+        continue;
+
+      dir = g_shell_unquote (flag->arg + 2, NULL);
+      if (dir == NULL)
+        dir = g_strdup (flag->arg + 2);
+      dirs = g_list_append (dirs, g_strconcat (pcsysrootdir ? pcsysrootdir
+                                               : "", dir, NULL));
+      g_free (dir);
+    }
+
+  includes = scan_includes (dirs);
+
+  variant = index_variant ();
+  provider_index = provider_index_open (search_dirs, variant);
+  g_free (variant);
+
+  seen = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  for (tmp = includes; tmp != NULL; tmp = g_list_next (tmp))
+    {
+      const char *header = tmp->data;
+      char *key = NULL;
+      gboolean own = FALSE;
+
+      /* headers of the package itself */
+      for (iter = dirs; !own && iter != NULL; iter = g_list_next (iter))
+        {
+          char *path = g_build_filename (iter->data, header, NULL);
+          own = g_file_test (path, G_FILE_TEST_EXISTS);
+          g_free (path);
+        }
+      if (own)
+        continue;
+
+      if (provider_index != NULL)
+        key = provider_index_lookup (provider_index, header);
+      if (key == NULL)
+        {
+          debug_log (LOG_GRAPH,
+                     "No package provides <%s>, assuming a system header\n",
+                     header);
+          continue;
+        }
+
+      if (strcmp (key, pkg->key) != 0 && !g_hash_table_contains (seen, key))
+        {
+          debug_log (LOG_GRAPH, "<%s> is provided by '%s'\n", header, key);
+          g_hash_table_add (seen, key);
+          providers = g_list_prepend (providers, key);
+        }
+      else
+        g_free (key);
+    }
+  providers = g_list_sort (providers, (GCompareFunc) strcmp);
+
+  /* Leave out packages required by others in the set.  Of packages
+   * requiring each other, the first one is kept. */
+  variant = index_variant ();
+  index = requires_index_load (search_dirs, variant);
+  g_free (variant);
+  for (tmp = providers; tmp != NULL; tmp = g_list_next (tmp))
+    {
+      GHashTable *reached = g_hash_table_new (g_str_hash, g_str_equal);
+      gboolean redundant = FALSE;
+
+      for (iter = providers; !redundant && iter != NULL;
+           iter = g_list_next (iter))
+        {
+          GHashTable *back;
+
+          if (iter == tmp)
+            continue;
+
+          g_hash_table_remove_all (reached);
+          requires_index_reach (index, iter->data, reached);
+          if (!g_hash_table_contains (reached, tmp->data))
+            continue;
+
+          back = g_hash_table_new (g_str_hash, g_str_equal);
+          requires_index_reach (index, tmp->data, back);
+          redundant = !g_hash_table_contains (back, iter->data) ||
+            strcmp (iter->data, tmp->data) < 0;
+          g_hash_table_destroy (back);
+
+          if (redundant)
+            debug_log (LOG_GRAPH, "'%s' is already required by '%s'\n",
+                       (char *) tmp->data, (char *) iter->data);
+        }
+      g_hash_table_destroy (reached);
+
+      if (!redundant)
+        printf ("%s\n", (char *) tmp->data);
+    }
+
+  g_hash_table_destroy (index);
+  g_list_free (providers);
+  g_hash_table_destroy (seen);
+  if (provider_index != NULL)
+    g_mapped_file_unref (provider_index);
+  g_list_free_full (includes, g_free);
+  g_list_free_full (dirs, g_free);
+}
+
 void
 enable_private_libs(void)
 {
@@ -1230,6 +2886,13 @@ disable_private_libs(void)
   ignore_private_libs = TRUE;
 }
 
+void
+enable_resolved_libs(gboolean prefer_static)
+{
+  resolve_libs = TRUE;
+  resolve_static = prefer_static;
+}
+
 void
 enable_requires(void)
 {
@@ -1254,3 +2917,218 @@ disable_requires_private(void)
 {
   ignore_requires_private = TRUE;
 }
+
+static gint
+path_cmp (gconstpointer a, gconstpointer b)
+{
+  return strcmp (*(char **) a, *(char **) b);
+}
+
+/* Print a problem with the .pc file PATH as a "PATH\tKIND\tMESSAGE"
+ * line, taking MSG. */
+static void
+validate_report (const char *path, const char *kind, char *msg)
+{
+  printf ("%s\t%s\t%s\n", path, kind, msg);
+  g_free (msg);
+}
+
+static void
+validate_requires (Package *pkg, const char *path, GList *reqs,
+                   GHashTable *providers, int *problems)
+{
+  for (; reqs != NULL; reqs = g_list_next (reqs))
+    {
+      RequiredVersion *ver = reqs->data;
+      Package *req = g_hash_table_lookup (providers, ver->name);
+
+      if (req == NULL)
+        req = g_hash_table_lookup (packages, ver->name);
+
+      if (req == NULL)
+        {
+          validate_report (path, "requires",
+                           g_strdup_printf ("Package '%s', required by '%s', "
+                                            "not found", ver->name,
+                                            pkg->key));
+          (*problems)++;
+        }
+      else if (req->version != NULL &&
+               !version_test (ver->comparison, req->version, ver->version))
+        {
+          validate_report (path, "requires",
+                           g_strdup_printf ("Package '%s' requires '%s %s %s' "
+                                            "but version of %s is %s",
+                                            pkg->key, ver->name,
+                                            comparison_to_str (ver->comparison),
+                                            ver->version, ver->name,
+                                            req->version));
+          (*problems)++;
+        }
+    }
+}
+
+gboolean
+validate_all (GList *dirs, gboolean check_requires)
+{
+  GPtrArray *keys = g_ptr_array_new_with_free_func (g_free);
+  GPtrArray *paths = g_ptr_array_new_with_free_func (g_free);
+  GPtrArray **errors;
+  Package **pkgs;
+  int problems = 0;
+  guint i, j;
+  GList *tmp;
+
+  if (dirs == NULL)
+    dirs = search_dirs;
+
+  /* Report in a stable order: by directory, then by file name. */
+  for (tmp = dirs; tmp != NULL; tmp = g_list_next (tmp))
+    {
+      GPtrArray *dirkeys = g_ptr_array_new_with_free_func (g_free);
+      GPtrArray *dirpaths = g_ptr_array_new ();
+
+      list_pc_files (tmp->data, dirkeys, dirpaths);
+      g_ptr_array_sort (dirpaths, path_cmp);
+      for (i = 0; i < dirpaths->len; i++)
+        {
+          char *path = g_ptr_array_index (dirpaths, i);
+          char *key = g_path_get_basename (path);
+
+          key[strlen (key) - 3] = '\0';
+          g_ptr_array_add (keys, key);
+          g_ptr_array_add (paths, path);
+        }
+      g_ptr_array_free (dirkeys, TRUE);
+      g_ptr_array_free (dirpaths, TRUE);
+    }
+
+  debug_log (LOG_PARSE, "Validating %u package files\n", paths->len);
+
+  errors = g_new0 (GPtrArray *, paths->len);
+  pkgs = parse_package_files ((char **) keys->pdata, (char **) paths->pdata,
+                              paths->len, errors);
+
+  for (i = 0; i < paths->len; i++)
+    {
+      const char *path = g_ptr_array_index (paths, i);
+      Package *pkg = pkgs[i];
+
+      for (j = 0; j < errors[i]->len; j++)
+        validate_report (path, "parse",
+                         g_strdup (g_ptr_array_index (errors[i], j)));
+      problems += errors[i]->len;
+      g_ptr_array_free (errors[i], TRUE);
+
+      if (pkg == NULL)
+        continue;
+
+      if (pkg->name == NULL)
+        validate_report (path, "fields",
+                         g_strdup_printf ("Package '%s' has no Name: field",
+                                          pkg->key));
+      if (pkg->version == NULL)
+        validate_report (path, "fields",
+                         g_strdup_printf ("Package '%s' has no Version: field",
+                                          pkg->key));
+      if (pkg->description == NULL)
+        validate_report (path, "fields",
+                         g_strdup_printf ("Package '%s' has no Description: "
+                                          "field", pkg->key));
+      problems += (pkg->name == NULL) + (pkg->version == NULL) +
+        (pkg->description == NULL);
+    }
+  g_free (errors);
+
+  if (check_requires)
+    {
+      GHashTable *providers = g_hash_table_new (g_str_hash, g_str_equal);
+      GPtrArray *extra_keys = g_ptr_array_new ();
+      GPtrArray *extra_paths = g_ptr_array_new_with_free_func (g_free);
+      GPtrArray **extra_errors;
+      Package **extra;
+
+      /* The validated files shadow each other in order, as in the search
+       * path.  Requirements outside of them are looked up in the search
+       * path, and only those files are parsed. */
+      for (i = 0; i < paths->len; i++)
+        if (pkgs[i] != NULL &&
+            g_hash_table_lookup (providers, pkgs[i]->key) == NULL)
+          g_hash_table_insert (providers, pkgs[i]->key, pkgs[i]);
+
+      for (i = 0; i < paths->len; i++)
+        {
+          GList *lists[2];
+          int l;
+
+          if (pkgs[i] == NULL)
+            continue;
+          lists[0] = pkgs[i]->requires_entries;
+          lists[1] = pkgs[i]->requires_private_entries;
+          for (l = 0; l < 2; l++)
+            for (tmp = lists[l]; tmp != NULL; tmp = g_list_next (tmp))
+              {
+                RequiredVersion *ver = tmp->data;
+                GList *dir;
+
+                if (g_hash_table_contains (providers, ver->name))
+                  continue;
+                g_hash_table_insert (providers, ver->name, NULL);
+
+                for (dir = search_dirs; dir != NULL; dir = g_list_next (dir))
+                  {
+                    char *name = g_strconcat (ver->name, ".pc", NULL);
+                    char *path = g_build_filename (dir->data, name, NULL);
+
+                    g_free (name);
+                    if (g_file_test (path, G_FILE_TEST_IS_REGULAR))
+                      {
+                        g_ptr_array_add (extra_keys, ver->name);
+                        g_ptr_array_add (extra_paths, path);
+                        break;
+                      }
+                    g_free (path);
+                  }
+              }
+        }
+
+      /* Problems in those files are not reported, they are not being
+       * validated. */
+      extra_errors = g_new0 (GPtrArray *, extra_paths->len);
+      extra = parse_package_files ((char **) extra_keys->pdata,
+                                   (char **) extra_paths->pdata,
+                                   extra_paths->len, extra_errors);
+      for (i = 0; i < extra_paths->len; i++)
+        {
+          if (extra[i] != NULL)
+            g_hash_table_insert (providers, extra[i]->key, extra[i]);
+          g_ptr_array_free (extra_errors[i], TRUE);
+        }
+      g_free (extra_errors);
+      g_free (extra);
+
+      for (i = 0; i < paths->len; i++)
+        {
+          if (pkgs[i] == NULL)
+            continue;
+          validate_requires (pkgs[i], g_ptr_array_index (paths, i),
+                             pkgs[i]->requires_entries, providers, &problems);
+          validate_requires (pkgs[i], g_ptr_array_index (paths, i),
+                             pkgs[i]->requires_private_entries, providers,
+                             &problems);
+        }
+
+      g_hash_table_destroy (providers);
+      g_ptr_array_free (extra_keys, TRUE);
+      g_ptr_array_free (extra_paths, TRUE);
+    }
+
+  debug_log (LOG_PARSE, "Found %d problems in %u package files\n", problems,
+             paths->len);
+
+  g_free (pkgs);
+  g_ptr_array_free (keys, TRUE);
+  g_ptr_array_free (paths, TRUE);
+
+  return problems == 0;
+}
@@ -21,6 +21,7 @@
 #define PKG_CONFIG_PKG_H
 
 #include <glib.h>
+#include "log.h"
 
 typedef guint8 FlagType; /* bit mask for flag types */
 
@@ -89,14 +90,44 @@ Package *get_package               (const char *name);
 Package *get_package_quiet         (const char *name);
 char *   packages_get_flags        (GList      *pkgs,
                                     FlagType   flags);
+char *   packages_explain_flags    (GList      *pkgs,
+                                    FlagType   flags);
+gboolean packages_check_overlinking (GList     *pkgs,
+                                    char     **objects);
+gboolean packages_closure_stats    (GList      *pkgs,
+                                    gboolean   print,
+                                    int        max_packages,
+                                    int        max_libs,
+                                    int        max_output_bytes);
+void     packages_print_build_levels (GList    *pkgs);
 char *   package_get_var           (Package    *pkg,
                                     const char *var);
 char *   packages_get_var          (GList      *pkgs,
                                     const char *var);
 
+GList *system_include_dirs (void);
 void add_search_dir (const char *path);
 void add_search_dirs (const char *path, const char *separator);
+GList *get_search_dirs (void);
 void package_init (gboolean want_list);
+void package_reset (void);
+GList *packages_get_loaded (void);
+
+/* Forget the loaded packages with the given KEYS and those requiring
+ * them, so that they are read again when next looked up.  Returns the
+ * number of packages forgotten. */
+int packages_forget (GList *keys);
+
+/* Whether a package that cannot be loaded, for a missing Requires, a
+ * conflict or a missing field, makes pkg-config exit, as by default.
+ * Otherwise its lookup fails like that of a package that doesn't exist,
+ * and packages_forget_failed has to be called when the query is done.
+ */
+void packages_set_errors_fatal (gboolean fatal);
+
+/* Forget the packages that failed to load and those requiring them.
+ * Returns the number of packages forgotten. */
+int packages_forget_failed (void);
 int compare_versions (const char * a, const char *b);
 gboolean version_test (ComparisonType comparison,
                        const char *a,
@@ -105,17 +136,23 @@ gboolean version_test (ComparisonType comparison,
 const char *comparison_to_str (ComparisonType comparison);
 
 void print_package_list (void);
+gboolean print_rdepends (const char *name);
+gboolean print_which_provides (const char *query);
+void print_include_requires (Package *pkg);
+gboolean validate_all (GList *dirs, gboolean check_requires);
 
 void define_global_variable (const char *varname,
                              const char *varval);
 
 void debug_spew (const char *format, ...);
+void debug_log (LogCategory category, const char *format, ...);
 void verbose_error (const char *format, ...);
 
 gboolean name_ends_in_uninstalled (const char *str);
 
 void enable_private_libs(void);
 void disable_private_libs(void);
+void enable_resolved_libs(gboolean prefer_static);
 void enable_requires(void);
 void disable_requires(void);
 void enable_requires_private(gboolean tolerate_missing);
@@ -140,6 +177,9 @@ extern gboolean define_prefix;
 /* The name of the variable that acts as prefix, unless it is "prefix" */
 extern char *prefix_variable;
 
+/* If set, merge -I directories into an include farm under this directory. */
+extern char *include_farm_dir;
+
 #ifdef G_OS_WIN32
 /* If TRUE, output flags in MSVC syntax. */
 extern gboolean msvc_syntax;
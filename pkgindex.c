@@ -0,0 +1,1022 @@
+/*
+ * Copyright (C) 2026 pkg-config contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/* Indexes over all .pc files in the search path.  Loading every package
+ * through get_package would recurse into its dependencies and stop at
+ * the first broken one, so the files are parsed on their own, in
+ * parallel, and the results kept per search directory on disk.  A
+ * directory's cache is valid while its modification time is unchanged,
+ * which is what adding, removing or replacing a .pc file updates.  As
+ * the time has a resolution of one second, a cache written in the same
+ * second the directory was changed is not trusted.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "pkgindex.h"
+#include "parse.h"
+#include "resolve.h"
+#include "stats.h"
+
+#include <glib/gstdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#define REQUIRES_INDEX_MAGIC "pkg-config-requires-index 2"
+
+typedef struct
+{
+  const char *key;
+  const char *path;
+  GPtrArray *errors;
+  Package *pkg;
+} ParseJob;
+
+static void
+parse_job (gpointer data, gpointer user_data)
+{
+  ParseJob *job = data;
+
+  if (job->errors != NULL)
+    job->pkg = parse_package_file_collect (job->key, job->path, job->errors);
+  else
+    job->pkg = parse_package_file (job->key, job->path);
+}
+
+Package **
+parse_package_files (char **keys, char **paths, guint n, GPtrArray **errors)
+{
+  ParseJob *jobs;
+  Package **pkgs;
+  GThreadPool *pool = NULL;
+  guint threads;
+  guint i;
+
+  jobs = g_new0 (ParseJob, n);
+  for (i = 0; i < n; i++)
+    {
+      jobs[i].key = keys[i];
+      jobs[i].path = paths[i];
+      if (errors != NULL)
+        jobs[i].errors = errors[i] = g_ptr_array_new_with_free_func (g_free);
+    }
+
+  threads = MIN (g_get_num_processors (), n);
+  if (threads > 1)
+    pool = g_thread_pool_new (parse_job, NULL, threads, TRUE, NULL);
+
+  debug_log (LOG_LOOKUP, "Parsing %u package files with %u threads\n", n,
+             pool ? threads : 1);
+  for (i = 0; i < n; i++)
+    {
+      if (pool != NULL)
+        g_thread_pool_push (pool, &jobs[i], NULL);
+      else
+        parse_job (&jobs[i], NULL);
+    }
+  if (pool != NULL)
+    g_thread_pool_free (pool, FALSE, TRUE);
+
+  pkgs = g_new0 (Package *, n);
+  for (i = 0; i < n; i++)
+    pkgs[i] = jobs[i].pkg;
+  g_free (jobs);
+
+  return pkgs;
+}
+
+char *
+index_cache_dir (void)
+{
+  const char *dir = g_getenv ("PKG_CONFIG_INDEX_DIR");
+
+  if (dir != NULL && *dir != '\0')
+    return g_strdup (dir);
+
+  return g_build_filename (g_get_user_cache_dir (), "pkg-config", NULL);
+}
+
+static char *
+absolute_dir (const char *dir)
+{
+  char *cwd;
+  char *absdir;
+
+  if (g_path_is_absolute (dir))
+    return g_strdup (dir);
+
+  cwd = g_get_current_dir ();
+  absdir = g_build_filename (cwd, dir, NULL);
+  g_free (cwd);
+
+  return absdir;
+}
+
+void
+list_pc_files (const char *dir, GPtrArray *keys, GPtrArray *paths)
+{
+  GDir *gdir;
+  const gchar *name;
+
+  stats_add (STAT_DIRS_READ, 1);
+  gdir = g_dir_open (dir, 0, NULL);
+  if (gdir == NULL)
+    return;
+
+  while ((name = g_dir_read_name (gdir)))
+    {
+      if (!g_str_has_suffix (name, ".pc"))
+        continue;
+      g_ptr_array_add (keys, g_strndup (name, strlen (name) - 3));
+      g_ptr_array_add (paths, g_build_filename (dir, name, NULL));
+    }
+  g_dir_close (gdir);
+}
+
+static void
+index_entry_free (IndexEntry *entry)
+{
+  g_free (entry->key);
+  g_list_free_full (entry->requires, g_free);
+  g_list_free_full (entry->requires_private, g_free);
+  g_free (entry);
+}
+
+static IndexEntry *
+index_entry_from_package (Package *pkg)
+{
+  IndexEntry *entry = g_new0 (IndexEntry, 1);
+  GList *tmp;
+
+  entry->key = g_strdup (pkg->key);
+  for (tmp = pkg->requires_entries; tmp != NULL; tmp = g_list_next (tmp))
+    {
+      RequiredVersion *ver = tmp->data;
+
+      if (!g_list_find_custom (entry->requires, ver->name,
+                               (GCompareFunc) strcmp))
+        entry->requires = g_list_append (entry->requires,
+                                         g_strdup (ver->name));
+    }
+  for (tmp = pkg->requires_private_entries; tmp != NULL;
+       tmp = g_list_next (tmp))
+    {
+      RequiredVersion *ver = tmp->data;
+
+      if (!g_list_find_custom (entry->requires, ver->name,
+                               (GCompareFunc) strcmp) &&
+          !g_list_find_custom (entry->requires_private, ver->name,
+                               (GCompareFunc) strcmp))
+        entry->requires_private = g_list_append (entry->requires_private,
+                                                 g_strdup (ver->name));
+    }
+
+  return entry;
+}
+
+static GList *
+split_names (const char *str)
+{
+  char **names = g_strsplit (str, " ", -1);
+  GList *list = NULL;
+  char **name;
+
+  for (name = names; *name != NULL; name++)
+    if (**name != '\0')
+      list = g_list_prepend (list, g_strdup (*name));
+  g_strfreev (names);
+
+  return g_list_reverse (list);
+}
+
+static void
+append_names (GString *str, GList *names)
+{
+  for (; names != NULL; names = g_list_next (names))
+    {
+      g_string_append (str, names->data);
+      if (names->next != NULL)
+        g_string_append_c (str, ' ');
+    }
+}
+
+/* Each directory has an index per VARIANT, so that alternating
+ * --define-variable values don't keep rebuilding the same file. */
+static char *
+requires_index_path (const char *cachedir, const char *dir,
+                     const char *variant)
+{
+  char *key = g_strconcat (dir, "\n", variant, NULL);
+  char *sum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, key, -1);
+  char *name = g_strconcat ("requires-", sum, NULL);
+  char *path = g_build_filename (cachedir, name, NULL);
+
+  g_free (name);
+  g_free (sum);
+  g_free (key);
+
+  return path;
+}
+
+/* Read the cached entries of a directory last modified at MTIME into a
+ * list, or return FALSE if there is no cache or it is out of date. */
+static gboolean
+requires_index_read (const char *path, const char *header, time_t mtime,
+                     GList **entries)
+{
+  struct stat st;
+  char *contents;
+  char **lines;
+  char **line;
+  gboolean ok;
+
+  if (g_stat (path, &st) != 0 || st.st_mtime <= mtime ||
+      !g_file_get_contents (path, &contents, NULL, NULL))
+    return FALSE;
+
+  lines = g_strsplit (contents, "\n", -1);
+  g_free (contents);
+
+  ok = lines[0] != NULL && strcmp (lines[0], header) == 0;
+  for (line = lines + 1; ok && *line != NULL; line++)
+    {
+      char **fields;
+      IndexEntry *entry;
+
+      if (**line == '\0')
+        continue;
+
+      fields = g_strsplit (*line, "\t", 3);
+      if (g_strv_length (fields) != 3)
+        {
+          g_strfreev (fields);
+          ok = FALSE;
+          break;
+        }
+
+      entry = g_new0 (IndexEntry, 1);
+      entry->key = g_strdup (fields[0]);
+      entry->requires = split_names (fields[1]);
+      entry->requires_private = split_names (fields[2]);
+      *entries = g_list_prepend (*entries, entry);
+      g_strfreev (fields);
+    }
+  g_strfreev (lines);
+
+  if (!ok)
+    {
+      g_list_free_full (*entries, (GDestroyNotify) index_entry_free);
+      *entries = NULL;
+    }
+
+  return ok;
+}
+
+static void
+requires_index_write (const char *path, const char *header, GList *entries)
+{
+  GString *str = g_string_new (header);
+  GError *error = NULL;
+
+  g_string_append_c (str, '\n');
+  for (; entries != NULL; entries = g_list_next (entries))
+    {
+      IndexEntry *entry = entries->data;
+
+      g_string_append (str, entry->key);
+      g_string_append_c (str, '\t');
+      append_names (str, entry->requires);
+      g_string_append_c (str, '\t');
+      append_names (str, entry->requires_private);
+      g_string_append_c (str, '\n');
+    }
+
+  if (!g_file_set_contents (path, str->str, str->len, &error))
+    {
+      debug_log (LOG_LOOKUP,
+                 "Cannot write index '%s': %s\n", path, error->message);
+      g_error_free (error);
+    }
+  g_string_free (str, TRUE);
+}
+
+/* A search directory whose cache has to be rebuilt */
+typedef struct
+{
+  char *index;
+  char *header;
+  guint first; /* range of its files in the parse arrays */
+  guint n;
+} StaleDir;
+
+GHashTable *
+requires_index_load (GList *dirs, const char *variant)
+{
+  GHashTable *index;
+  GPtrArray *keys;
+  GPtrArray *paths;
+  GList *stale = NULL;
+  GList *per_dir = NULL;
+  GList *tmp;
+  Package **pkgs;
+  char *cachedir;
+  char *variant_sum;
+  gboolean have_cachedir;
+
+  cachedir = index_cache_dir ();
+  variant_sum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, variant, -1);
+  have_cachedir = g_mkdir_with_parents (cachedir, 0755) == 0;
+  if (!have_cachedir)
+    debug_log (LOG_LOOKUP, "Cannot create index directory '%s': %s\n", cachedir,
+               g_strerror (errno));
+
+  keys = g_ptr_array_new_with_free_func (g_free);
+  paths = g_ptr_array_new_with_free_func (g_free);
+
+  /* PER_DIR holds a list of entries for each directory in search order;
+   * stale directories get theirs after parsing. */
+  for (tmp = dirs; tmp != NULL; tmp = g_list_next (tmp))
+    {
+      const char *dir = tmp->data;
+      char *absdir;
+      GList *entries = NULL;
+      StaleDir *sd;
+      struct stat st;
+
+      if (g_stat (dir, &st) != 0 || !S_ISDIR (st.st_mode))
+        {
+          per_dir = g_list_prepend (per_dir, NULL);
+          continue;
+        }
+
+      absdir = absolute_dir (dir);
+      sd = g_new0 (StaleDir, 1);
+      sd->index = requires_index_path (cachedir, absdir, variant);
+      sd->header = g_strdup_printf ("%s %ld %s %s", REQUIRES_INDEX_MAGIC,
+                                    (long) st.st_mtime, variant_sum, absdir);
+      g_free (absdir);
+
+      if (requires_index_read (sd->index, sd->header, st.st_mtime, &entries))
+        {
+          stats_add (STAT_INDEX_HITS, 1);
+          debug_log (LOG_LOOKUP,
+                     "Using requires index '%s' for '%s'\n", sd->index, dir);
+          per_dir = g_list_prepend (per_dir, entries);
+          g_free (sd->index);
+          g_free (sd->header);
+          g_free (sd);
+          continue;
+        }
+
+      debug_log (LOG_LOOKUP, "Indexing '%s'\n", dir);
+      sd->first = paths->len;
+      list_pc_files (dir, keys, paths);
+      sd->n = paths->len - sd->first;
+
+      stale = g_list_append (stale, sd);
+      per_dir = g_list_prepend (per_dir, sd);
+    }
+  per_dir = g_list_reverse (per_dir);
+
+  pkgs = parse_package_files ((char **) keys->pdata, (char **) paths->pdata,
+                              paths->len, NULL);
+
+  for (tmp = stale; tmp != NULL; tmp = g_list_next (tmp))
+    {
+      StaleDir *sd = tmp->data;
+      GList *entries = NULL;
+      guint i;
+
+      for (i = sd->first; i < sd->first + sd->n; i++)
+        if (pkgs[i] != NULL)
+          entries = g_list_prepend (entries,
+                                    index_entry_from_package (pkgs[i]));
+      if (have_cachedir)
+        requires_index_write (sd->index, sd->header, entries);
+
+      g_list_find (per_dir, sd)->data = entries;
+      g_free (sd->index);
+      g_free (sd->header);
+      g_free (sd);
+    }
+  g_list_free (stale);
+  g_free (pkgs);
+  g_ptr_array_free (keys, TRUE);
+  g_ptr_array_free (paths, TRUE);
+  g_free (variant_sum);
+  g_free (cachedir);
+
+  index = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+                                 (GDestroyNotify) index_entry_free);
+  for (tmp = per_dir; tmp != NULL; tmp = g_list_next (tmp))
+    {
+      GList *entries;
+
+      for (entries = tmp->data; entries != NULL; entries = g_list_next (entries))
+        {
+          IndexEntry *entry = entries->data;
+
+          if (g_hash_table_contains (index, entry->key))
+            index_entry_free (entry);
+          else
+            g_hash_table_insert (index, entry->key, entry);
+        }
+      g_list_free (tmp->data);
+    }
+  g_list_free (per_dir);
+
+  return index;
+}
+
+/* The provider index maps each header below a package's -I directories
+ * and each of its -l flags to the package.  It is a sorted text file,
+ * "NAME\tPACKAGE" per line after a header line identifying the search
+ * path it was built from, so lookups are a binary search over the
+ * mapped file.  Between the two, a "walked N" line is followed by the
+ * N header and library directories read while building the index, as
+ * "MTIME\tDIR", so that changes below them are noticed too.
+ */
+
+#define PROVIDER_INDEX_MAGIC "pkg-config-providers-index 2"
+
+typedef struct
+{
+  const char *key;
+  int rank;
+} Provider;
+
+/* Unquote the directory of an -I or -L flag and apply the sysroot */
+static char *
+flag_dir (const char *arg)
+{
+  char *dir;
+  char *retval;
+
+  dir = g_shell_unquote (arg, NULL);
+  if (dir == NULL)
+    dir = g_strdup (arg);
+  if (pcsysrootdir == NULL)
+    return dir;
+
+  retval = g_strconcat (pcsysrootdir, dir, NULL);
+  g_free (dir);
+
+  return retval;
+}
+
+/* Record KEY as providing NAME unless a package with a lower RANK
+ * already does. */
+static void
+provider_add (GHashTable *providers, const char *name, const char *key,
+              int rank)
+{
+  Provider *cur = g_hash_table_lookup (providers, name);
+
+  if (strchr (name, '\t') != NULL || strchr (name, '\n') != NULL)
+    return;
+
+  if (cur == NULL)
+    {
+      cur = g_new (Provider, 1);
+      g_hash_table_insert (providers, g_strdup (name), cur);
+    }
+  else if (cur->rank < rank ||
+           (cur->rank == rank && strcmp (cur->key, key) <= 0))
+    return;
+
+  cur->key = key;
+  cur->rank = rank;
+}
+
+static void
+provider_add_headers (GHashTable *providers, GHashTable *walked,
+                      const char *dir, const char *rel, const char *key,
+                      int rank)
+{
+  GDir *gdir;
+  const gchar *name;
+  char *path;
+
+  path = rel ? g_build_filename (dir, rel, NULL) : g_strdup (dir);
+  g_hash_table_add (walked, g_strdup (path));
+  gdir = g_dir_open (path, 0, NULL);
+  if (gdir == NULL)
+    {
+      g_free (path);
+      return;
+    }
+
+  while ((name = g_dir_read_name (gdir)))
+    {
+      char *child = g_build_filename (path, name, NULL);
+      char *relchild = rel ? g_strconcat (rel, "/", name, NULL)
+                           : g_strdup (name);
+      struct stat st;
+
+      /* don't follow symlinked directories, which may loop */
+      if (g_lstat (child, &st) == 0 && S_ISDIR (st.st_mode))
+        provider_add_headers (providers, walked, dir, relchild, key, rank);
+      else if (g_file_test (child, G_FILE_TEST_IS_REGULAR))
+        provider_add (providers, relchild, key, rank);
+
+      g_free (relchild);
+      g_free (child);
+    }
+
+  g_dir_close (gdir);
+  g_free (path);
+}
+
+/* Like verify_package, -I flags naming one of SYSINCDIRS are left out;
+ * SYSLIBDIRS are the system library directories under the sysroot. */
+static void
+provider_add_package (GHashTable *providers, GHashTable *walked,
+                      Package *pkg, GList *sysincdirs, GList *syslibdirs)
+{
+  GList *libdirs = NULL;
+  GList *tmp;
+  /* Packages earlier in the path win, but for libraries, packages whose
+   * own -L directories hold the library come first. */
+  int rank = pkg->path_position;
+  int system_rank = G_MAXINT / 2 + pkg->path_position;
+
+  for (tmp = pkg->cflags; tmp != NULL; tmp = g_list_next (tmp))
+    {
+      Flag *flag = tmp->data;
+      char *dir;
+
+      if (flag->type != CFLAGS_I || strncmp (flag->arg, "-I", 2) != 0 ||
+          g_list_find_custom (sysincdirs, flag->arg + 2,
+                              (GCompareFunc) strcmp) != NULL)
+        continue;
+
+      dir = flag_dir (flag->arg + 2);
+      provider_add_headers (providers, walked, dir, NULL, pkg->key, rank);
+      g_free (dir);
+    }
+
+  for (tmp = pkg->libs; tmp != NULL; tmp = g_list_next (tmp))
+    {
+      Flag *flag = tmp->data;
+      const char *arg;
+
+      if (flag->type == LIBS_L && (arg = lib_dir_from_flag (flag->arg)))
+        libdirs = g_list_append (libdirs, flag_dir (arg));
+    }
+
+  for (tmp = libdirs; tmp != NULL; tmp = g_list_next (tmp))
+    g_hash_table_add (walked, g_strdup (tmp->data));
+
+  for (tmp = pkg->libs; tmp != NULL; tmp = g_list_next (tmp))
+    {
+      Flag *flag = tmp->data;
+      GList *sys;
+      const char *name;
+      char *path;
+
+      if (flag->type != LIBS_l || !(name = lib_name_from_flag (flag->arg)))
+        continue;
+
+      for (sys = syslibdirs; sys != NULL; sys = g_list_next (sys))
+        g_hash_table_add (walked, g_strdup (sys->data));
+
+      if ((path = resolve_library (name, libdirs, FALSE)) != NULL)
+        provider_add (providers, flag->arg, pkg->key, rank);
+      else if ((path = resolve_library (name, syslibdirs, FALSE)) != NULL)
+        provider_add (providers, flag->arg, pkg->key, system_rank);
+      else
+        debug_log (LOG_LOOKUP, "Library '%s' of '%s' not found, not indexed\n",
+                   flag->arg, pkg->key);
+      g_free (path);
+    }
+
+  g_list_free_full (libdirs, g_free);
+}
+
+/* The system include directories whose -I flags are stripped, unless
+ * PKG_CONFIG_ALLOW_SYSTEM_CFLAGS is set, and the system library
+ * directories under the sysroot, as resolve_lib_flags searches them. */
+static void
+provider_system_dirs (GList **sysincdirsp, GList **syslibdirsp)
+{
+  GList *tmp;
+
+  *sysincdirsp = NULL;
+  if (g_getenv ("PKG_CONFIG_ALLOW_SYSTEM_CFLAGS") == NULL)
+    *sysincdirsp = system_include_dirs ();
+
+  *syslibdirsp = NULL;
+  for (tmp = system_library_dirs (); tmp != NULL; tmp = g_list_next (tmp))
+    *syslibdirsp = g_list_append (*syslibdirsp,
+                                  g_strconcat (pcsysrootdir ? pcsysrootdir
+                                               : "", tmp->data, NULL));
+}
+
+/* The index file for a search path, sysroot, system directories and
+ * VARIANT (anything else that changes how .pc files parse) is named
+ * after them, and
+ * its header line covers the modification times of the directories.
+ * NEWESTP is set to the newest of those times. */
+static void
+provider_index_names (GList *dirs, GList *sysincdirs, GList *syslibdirs,
+                      const char *variant, const char *cachedir,
+                      char **pathp, char **headerp, time_t *newestp)
+{
+  GList *tmp;
+  GString *str = g_string_new (NULL);
+  GString *mtimes = g_string_new (NULL);
+  char *sum;
+  char *name;
+
+  *newestp = 0;
+  for (; dirs != NULL; dirs = g_list_next (dirs))
+    {
+      char *absdir = absolute_dir (dirs->data);
+      struct stat st;
+
+      g_string_append_printf (str, "%s\n", absdir);
+      if (g_stat (absdir, &st) == 0)
+        {
+          g_string_append_printf (mtimes, "%ld\n", (long) st.st_mtime);
+          *newestp = MAX (*newestp, st.st_mtime);
+        }
+      else
+        g_string_append (mtimes, "-\n");
+      g_free (absdir);
+    }
+  g_string_append_printf (str, "%s\n", pcsysrootdir ? pcsysrootdir : "");
+  for (tmp = sysincdirs; tmp != NULL; tmp = g_list_next (tmp))
+    g_string_append_printf (str, "-I%s\n", (char *) tmp->data);
+  for (tmp = syslibdirs; tmp != NULL; tmp = g_list_next (tmp))
+    g_string_append_printf (str, "-L%s\n", (char *) tmp->data);
+  g_string_append (str, variant);
+
+  sum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, str->str, -1);
+  name = g_strconcat ("providers-", sum, NULL);
+  *pathp = g_build_filename (cachedir, name, NULL);
+  g_free (name);
+  g_free (sum);
+
+  sum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, mtimes->str, -1);
+  *headerp = g_strdup_printf ("%s %s", PROVIDER_INDEX_MAGIC, sum);
+  g_free (sum);
+
+  g_string_free (mtimes, TRUE);
+  g_string_free (str, TRUE);
+}
+
+static int
+strcmp_cmp (gconstpointer a, gconstpointer b)
+{
+  return strcmp (*(const char **) a, *(const char **) b);
+}
+
+static gboolean
+provider_index_build (GList *dirs, GList *sysincdirs, GList *syslibdirs,
+                      const char *path, const char *header)
+{
+  GHashTable *providers;
+  GHashTable *seen;
+  GHashTable *walked;
+  GPtrArray *keys;
+  GPtrArray *paths;
+  GArray *positions;
+  GPtrArray *names;
+  GHashTableIter iter;
+  gpointer name;
+  gpointer value;
+  GString *str;
+  GList *tmp;
+  Package **pkgs;
+  GError *error = NULL;
+  guint i;
+  int position = 0;
+  gboolean ok;
+
+  keys = g_ptr_array_new_with_free_func (g_free);
+  paths = g_ptr_array_new_with_free_func (g_free);
+  positions = g_array_new (FALSE, FALSE, sizeof (int));
+  for (tmp = dirs; tmp != NULL; tmp = g_list_next (tmp))
+    {
+      position++;
+      list_pc_files (tmp->data, keys, paths);
+      while (positions->len < paths->len)
+        g_array_append_val (positions, position);
+    }
+
+  pkgs = parse_package_files ((char **) keys->pdata, (char **) paths->pdata,
+                              paths->len, NULL);
+
+  providers = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                     g_free);
+  seen = g_hash_table_new (g_str_hash, g_str_equal);
+  walked = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  for (i = 0; i < paths->len; i++)
+    {
+      Package *pkg = pkgs[i];
+
+      /* earlier directories shadow later ones */
+      if (pkg == NULL || g_hash_table_contains (seen, pkg->key))
+        continue;
+      g_hash_table_add (seen, pkg->key);
+
+      pkg->path_position = g_array_index (positions, int, i);
+      provider_add_package (providers, walked, pkg, sysincdirs, syslibdirs);
+    }
+
+  names = g_ptr_array_new ();
+  g_hash_table_iter_init (&iter, walked);
+  while (g_hash_table_iter_next (&iter, &name, NULL))
+    if (strchr (name, '\n') == NULL)
+      g_ptr_array_add (names, name);
+  g_ptr_array_sort (names, strcmp_cmp);
+
+  str = g_string_new (header);
+  g_string_append_printf (str, "\nwalked %u\n", names->len);
+  for (i = 0; i < names->len; i++)
+    {
+      struct stat st;
+
+      if (g_stat (g_ptr_array_index (names, i), &st) == 0)
+        g_string_append_printf (str, "%ld", (long) st.st_mtime);
+      else
+        g_string_append_c (str, '-');
+      g_string_append_printf (str, "\t%s\n",
+                              (char *) g_ptr_array_index (names, i));
+    }
+  g_ptr_array_set_size (names, 0);
+
+  g_hash_table_iter_init (&iter, providers);
+  while (g_hash_table_iter_next (&iter, &name, NULL))
+    g_ptr_array_add (names, name);
+  g_ptr_array_sort (names, strcmp_cmp);
+
+  for (i = 0; i < names->len; i++)
+    {
+      value = g_hash_table_lookup (providers, g_ptr_array_index (names, i));
+      g_string_append_printf (str, "%s\t%s\n",
+                              (char *) g_ptr_array_index (names, i),
+                              ((Provider *) value)->key);
+    }
+  debug_log (LOG_LOOKUP, "Indexed %u headers and libraries of %u packages\n",
+             names->len, g_hash_table_size (seen));
+
+  ok = g_file_set_contents (path, str->str, str->len, &error);
+  if (!ok)
+    {
+      debug_log (LOG_LOOKUP,
+                 "Cannot write index '%s': %s\n", path, error->message);
+      g_error_free (error);
+    }
+
+  g_string_free (str, TRUE);
+  g_ptr_array_free (names, TRUE);
+  g_hash_table_destroy (walked);
+  g_hash_table_destroy (seen);
+  g_hash_table_destroy (providers);
+  g_free (pkgs);
+  g_array_free (positions, TRUE);
+  g_ptr_array_free (keys, TRUE);
+  g_ptr_array_free (paths, TRUE);
+
+  return ok;
+}
+
+/* Check the header line and the walked directories of the index DATA,
+ * written at INDEX_MTIME, and return the offset of its first entry, or
+ * 0 if it is out of date.  Like for the requires index, a directory
+ * modified in the same second as the index may have changed after it
+ * was written, so it makes the index stale too.  NEWEST is the newest
+ * modification time of the .pc directories. */
+static gsize
+provider_index_check (const char *data, gsize len, const char *header,
+                      time_t index_mtime, time_t newest)
+{
+  gsize header_len = strlen (header);
+  const char *line;
+  const char *end = data + len;
+  char *walked_end;
+  unsigned long n;
+
+  if (index_mtime <= newest || len <= header_len ||
+      strncmp (data, header, header_len) != 0 || data[header_len] != '\n')
+    return 0;
+
+  line = data + header_len + 1;
+  if (end - line < 7 || strncmp (line, "walked ", 7) != 0)
+    return 0;
+  n = strtoul (line + 7, &walked_end, 10);
+  if (walked_end >= end || *walked_end != '\n')
+    return 0;
+  line = walked_end + 1;
+
+  for (; n > 0; n--)
+    {
+      const char *nl = memchr (line, '\n', end - line);
+      const char *tab;
+      char *dir;
+      char *cur;
+      struct stat st;
+      gboolean same;
+
+      if (nl == NULL || (tab = memchr (line, '\t', nl - line)) == NULL)
+        return 0;
+
+      dir = g_strndup (tab + 1, nl - tab - 1);
+      if (g_stat (dir, &st) == 0)
+        cur = st.st_mtime >= index_mtime ? NULL :
+          g_strdup_printf ("%ld", (long) st.st_mtime);
+      else
+        cur = g_strdup ("-");
+      same = cur != NULL && strlen (cur) == (gsize) (tab - line) &&
+        strncmp (line, cur, tab - line) == 0;
+      if (!same)
+        debug_log (LOG_LOOKUP, "Directory '%s' changed\n", dir);
+      g_free (cur);
+      g_free (dir);
+
+      if (!same)
+        return 0;
+      line = nl + 1;
+    }
+
+  return line - data;
+}
+
+/* The offset of the first entry of the index DATA, after the header
+ * line and the walked directories. */
+static gsize
+provider_index_entries (const char *data, gsize len)
+{
+  const char *line = memchr (data, '\n', len);
+  unsigned long n;
+
+  if (line == NULL)
+    return len;
+  line++;
+  /* the "walked N" line and the N directories after it */
+  n = strtoul (line + 7, NULL, 10) + 1;
+  for (; n > 0 && line != NULL; n--)
+    {
+      line = memchr (line, '\n', data + len - line);
+      if (line != NULL)
+        line++;
+    }
+
+  return line != NULL ? (gsize) (line - data) : len;
+}
+
+/* Binary search the sorted entry lines in DATA for NAME and return a
+ * copy of its package. */
+static char *
+provider_index_find (const char *data, gsize len, const char *name)
+{
+  gsize lo = provider_index_entries (data, len);
+  gsize hi = len;
+  gsize namelen = strlen (name);
+
+  while (lo < hi)
+    {
+      gsize line = lo + (hi - lo) / 2;
+      const char *end;
+      const char *tab;
+      int cmp;
+
+      /* back up to the start of the line */
+      while (line > lo && data[line - 1] != '\n')
+        line--;
+
+      end = memchr (data + line, '\n', len - line);
+      if (end == NULL)
+        end = data + len;
+      tab = memchr (data + line, '\t', end - (data + line));
+      if (tab == NULL)
+        return NULL;
+
+      cmp = strncmp (data + line, name, MIN ((gsize) (tab - (data + line)),
+                                             namelen));
+      if (cmp == 0)
+        cmp = (int) (tab - (data + line)) - (int) namelen;
+
+      if (cmp == 0)
+        return g_strndup (tab + 1, end - tab - 1);
+      else if (cmp < 0)
+        lo = end - data + 1;
+      else
+        hi = line;
+    }
+
+  return NULL;
+}
+
+/* The index names for QUERY in lookup order: "<gdk/gdk.h>" is the header
+ * gdk/gdk.h, "libcairo.so" and "cairo" are -lcairo. */
+static GList *
+provider_query_names (const char *query)
+{
+  GList *names = NULL;
+  gsize len = strlen (query);
+  char *name;
+
+  if (len > 2 && ((query[0] == '<' && query[len - 1] == '>') ||
+                  (query[0] == '"' && query[len - 1] == '"')))
+    return g_list_prepend (NULL, g_strndup (query + 1, len - 2));
+
+  if (g_str_has_prefix (query, "-l"))
+    return g_list_prepend (NULL, g_strdup (query));
+
+  names = g_list_append (names, g_strdup (query));
+  if (g_str_has_prefix (query, "lib") &&
+      (strstr (query, ".so") != NULL || g_str_has_suffix (query, ".a")))
+    {
+      name = g_strndup (query + 3, strcspn (query + 3, "."));
+      names = g_list_append (names, g_strconcat ("-l", name, NULL));
+      g_free (name);
+    }
+  else if (strchr (query, '/') == NULL && strchr (query, '.') == NULL)
+    names = g_list_append (names, g_strconcat ("-l", query, NULL));
+
+  return names;
+}
+
+GMappedFile *
+provider_index_open (GList *dirs, const char *variant)
+{
+  GList *sysincdirs;
+  GList *syslibdirs;
+  char *cachedir;
+  char *header;
+  char *index;
+  GMappedFile *file;
+  struct stat st;
+  time_t newest;
+
+  cachedir = index_cache_dir ();
+  provider_system_dirs (&sysincdirs, &syslibdirs);
+  provider_index_names (dirs, sysincdirs, syslibdirs, variant, cachedir,
+                        &index, &header, &newest);
+
+  file = g_mapped_file_new (index, FALSE, NULL);
+  if (file != NULL &&
+      (g_stat (index, &st) != 0 ||
+       provider_index_check (g_mapped_file_get_contents (file),
+                             g_mapped_file_get_length (file), header,
+                             st.st_mtime, newest) == 0))
+    {
+      g_mapped_file_unref (file);
+      file = NULL;
+    }
+
+  if (file == NULL)
+    {
+      debug_log (LOG_LOOKUP, "Building provider index '%s'\n", index);
+      if (g_mkdir_with_parents (cachedir, 0755) == 0 &&
+          provider_index_build (dirs, sysincdirs, syslibdirs, index, header))
+        file = g_mapped_file_new (index, FALSE, NULL);
+    }
+
+  g_list_free_full (sysincdirs, g_free);
+  g_list_free_full (syslibdirs, g_free);
+  g_free (index);
+  g_free (header);
+  g_free (cachedir);
+
+  return file;
+}
+
+char *
+provider_index_lookup (GMappedFile *index, const char *query)
+{
+  GList *names;
+  GList *tmp;
+  char *key = NULL;
+
+  names = provider_query_names (query);
+  for (tmp = names; key == NULL && tmp != NULL; tmp = g_list_next (tmp))
+    key = provider_index_find (g_mapped_file_get_contents (index),
+                               g_mapped_file_get_length (index), tmp->data);
+  g_list_free_full (names, g_free);
+
+  return key;
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2026 pkg-config contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef PKG_CONFIG_PKGINDEX_H
+#define PKG_CONFIG_PKGINDEX_H
+
+#include "pkg.h"
+
+/* The direct requirements of one .pc file, by module name. */
+typedef struct
+{
+  char *key;
+  GList *requires;         /* list of char* */
+  GList *requires_private; /* list of char*, without the public ones */
+} IndexEntry;
+
+/* Parse the N .pc files PATHS, with package keys KEYS, in parallel.
+ * Dependencies are not loaded.  Returns an array of N packages, with
+ * NULL for files that could not be parsed.  If ERRORS is not NULL, it
+ * is an array of N that gets the messages of each file in a new
+ * GPtrArray, as with parse_package_file_collect.
+ */
+Package **parse_package_files (char **keys, char **paths, guint n,
+                               GPtrArray **errors);
+
+/* Add the keys and paths of the .pc files in DIR to KEYS and PATHS. */
+void list_pc_files (const char *dir, GPtrArray *keys, GPtrArray *paths);
+
+/* Return a table mapping the key of every .pc file in DIRS to its
+ * IndexEntry.  Files in earlier directories shadow those in later ones,
+ * as in package lookup.  The entries of each directory are cached
+ * under index_cache_dir() per VARIANT, as for provider_index_open, and
+ * only re-read when its mtime changes.
+ */
+GHashTable *requires_index_load (GList *dirs, const char *variant);
+
+/* Open the provider index of DIRS, building it first if there is none
+ * or a directory in DIRS has changed.  Indexes are kept per DIRS and
+ * VARIANT, a string covering anything else that affects parsing.
+ * Returns NULL if the index cannot be built; release it with
+ * g_mapped_file_unref.
+ */
+GMappedFile *provider_index_open (GList *dirs, const char *variant);
+
+/* Return the key of the package that provides QUERY, a header relative
+ * to an -I directory such as "gdk/gdk.h" or "<gdk/gdk.h>", or a library
+ * such as "-lcairo", "cairo" or "libcairo.so".  If several do, one
+ * whose own -L directories hold the library wins over ones that only
+ * find it in the system directories, and then the one earliest in the
+ * search path.  Returns NULL if no package provides it.
+ */
+char *provider_index_lookup (GMappedFile *index, const char *query);
+
+/* The directory holding on-disk indexes: $PKG_CONFIG_INDEX_DIR, or
+ * pkg-config under the user's cache directory. */
+char *index_cache_dir (void);
+
+#endif
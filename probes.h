@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2026 pkg-config contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef PKG_CONFIG_PROBES_H
+#define PKG_CONFIG_PROBES_H
+
+/* USDT probes for bpftrace, perf, SystemTap and the like, in provider
+ * pkg_config.  Without <sys/sdt.h> they compile to nothing; with it
+ * each is a single nop until a tracer attaches, and their arguments are
+ * values at hand, so they cost nothing either way.  For example:
+ *
+ *   bpftrace -e 'usdt:/usr/bin/pkg-config:pkg_config:lookup__end
+ *     { printf("%s %d\n", str(arg0), arg3); }'
+ *
+ * lookup__start   (name)
+ * lookup__end     (name, directory, path, found)
+ * file__open      (path, errno or 0)
+ * parse__start    (key, path)
+ * parse__end      (key, path, lines)
+ * requires__edge  (key, required name, private)
+ * conflict__check (key, conflict name, required key)
+ * flags__emit     (FlagType mask, length, flags)
+ * exit            (status, or -1 if unknown)
+ *
+ * Strings that are not known are NULL.
+ */
+
+#ifdef HAVE_SYS_SDT_H
+
+#include <sys/sdt.h>
+
+#define PROBE1(name, a) DTRACE_PROBE1 (pkg_config, name, a)
+#define PROBE2(name, a, b) DTRACE_PROBE2 (pkg_config, name, a, b)
+#define PROBE3(name, a, b, c) DTRACE_PROBE3 (pkg_config, name, a, b, c)
+#define PROBE4(name, a, b, c, d) DTRACE_PROBE4 (pkg_config, name, a, b, c, d)
+
+#else
+
+#define PROBE1(name, a)
+#define PROBE2(name, a, b)
+#define PROBE3(name, a, b, c)
+#define PROBE4(name, a, b, c, d)
+
+#endif
+
+#endif
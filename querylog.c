@@ -0,0 +1,211 @@
+/*
+ * Copyright (C) 2026 pkg-config contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/* The PKG_CONFIG_LOG query log: one JSON object per line and per
+ * invocation, so that a build's calls can be analyzed afterwards (see
+ * tools/analyze-log).  Many pkg-config processes of a parallel build
+ * append to the same file, so each record is written with a single
+ * write() to a descriptor opened with O_APPEND, which keeps records
+ * from being interleaved.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "querylog.h"
+#include "json.h"
+#include "stats.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef G_OS_WIN32
+#include <io.h>
+#include <process.h>
+#define getpid _getpid
+#endif
+
+static int log_fd = -1;
+static gint64 start_time;
+static gint64 start_real_time;
+static char **log_argv = NULL;
+static char *log_cwd = NULL;
+static GString *modules = NULL;
+
+static int
+name_cmp (const void *a, const void *b)
+{
+  return strcmp (*(char * const *) a, *(char * const *) b);
+}
+
+/* The PKG_CONFIG_ variables, which decide what a query returns */
+static void
+append_env (GString *out)
+{
+  gchar **names = g_listenv ();
+  gboolean first = TRUE;
+  int i;
+
+  qsort (names, g_strv_length (names), sizeof (char *), name_cmp);
+  g_string_append_c (out, '{');
+  for (i = 0; names[i] != NULL; i++)
+    {
+      if (!g_str_has_prefix (names[i], "PKG_CONFIG_") ||
+          strcmp (names[i], "PKG_CONFIG_LOG") == 0)
+        continue;
+      if (!first)
+        g_string_append_c (out, ',');
+      json_append_string (out, names[i]);
+      g_string_append_c (out, ':');
+      json_append_string (out, g_getenv (names[i]));
+      first = FALSE;
+    }
+  g_string_append_c (out, '}');
+  g_strfreev (names);
+}
+
+static void
+write_record (int status, gboolean status_known)
+{
+  GString *out = g_string_new (NULL);
+  const char *p;
+  gsize left;
+  int i;
+
+  g_string_append_printf (out, "{\"time_us\":%" G_GINT64_FORMAT
+                          ",\"pid\":%d,\"cwd\":",
+                          start_real_time, (int) getpid ());
+  json_append_string (out, log_cwd);
+  g_string_append (out, ",\"argv\":[");
+  for (i = 0; log_argv[i] != NULL; i++)
+    {
+      if (i > 0)
+        g_string_append_c (out, ',');
+      json_append_string (out, log_argv[i]);
+    }
+  g_string_append (out, "],\"env\":");
+  append_env (out);
+  g_string_append_printf (out, ",\"modules\":[%s]", modules->str);
+  if (status_known)
+    g_string_append_printf (out, ",\"exit\":%d", status);
+  else
+    g_string_append (out, ",\"exit\":null");
+  g_string_append_printf (out, ",\"duration_us\":%" G_GINT64_FORMAT
+                          ",\"packages_loaded\":%" G_GSIZE_FORMAT
+                          ",\"files_opened\":%" G_GSIZE_FORMAT
+                          ",\"cache_hits\":%" G_GSIZE_FORMAT
+                          ",\"index_hits\":%" G_GSIZE_FORMAT "}\n",
+                          g_get_monotonic_time () - start_time,
+                          stats_get (STAT_PACKAGES_LOADED),
+                          stats_get (STAT_FILES_OPENED),
+                          stats_get (STAT_CACHE_HITS),
+                          stats_get (STAT_INDEX_HITS));
+
+  /* A regular file takes the whole record at once; the loop is only for
+   * pipes and the like, which may write less. */
+  p = out->str;
+  left = out->len;
+  while (left > 0)
+    {
+      gssize written = write (log_fd, p, left);
+
+      if (written < 0 && errno == EINTR)
+        continue;
+      if (written <= 0)
+        break;
+      p += written;
+      left -= written;
+    }
+
+  close (log_fd);
+  log_fd = -1;
+  g_string_free (out, TRUE);
+}
+
+#ifdef HAVE_ON_EXIT
+static void
+querylog_exit (int status, void *data)
+{
+  write_record (status, TRUE);
+}
+#else
+static void
+querylog_exit (void)
+{
+  write_record (0, FALSE);
+}
+#endif
+
+void
+querylog_open (const char *path, int argc, char **argv)
+{
+  int i;
+
+  start_time = g_get_monotonic_time ();
+  start_real_time = g_get_real_time ();
+
+  log_fd = open (path, O_WRONLY | O_APPEND | O_CREAT, 0666);
+  if (log_fd < 0)
+    {
+      fprintf (stderr, "Cannot open log file: %s\n", path);
+      exit (1);
+    }
+
+  log_argv = g_new0 (char *, argc + 1);
+  for (i = 0; i < argc; i++)
+    log_argv[i] = g_strdup (argv[i]);
+  log_cwd = g_get_current_dir ();
+  modules = g_string_new (NULL);
+
+  /* the packages loaded and cache hits come from the counters */
+  stats_collect ();
+
+#ifdef HAVE_ON_EXIT
+  on_exit (querylog_exit, NULL);
+#else
+  atexit (querylog_exit);
+#endif
+}
+
+void
+querylog_module (const char *name, const char *comparison,
+                 const char *version, gboolean found)
+{
+  if (modules == NULL)
+    return;
+
+  if (modules->len > 0)
+    g_string_append_c (modules, ',');
+  g_string_append (modules, "{\"name\":");
+  json_append_string (modules, name);
+  if (version != NULL)
+    {
+      g_string_append (modules, ",\"constraint\":");
+      json_append_string (modules, comparison);
+      g_string_append (modules, ",\"version\":");
+      json_append_string (modules, version);
+    }
+  g_string_append_printf (modules, ",\"found\":%s}", found ? "true" : "false");
+}
@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2026 pkg-config contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef PKG_CONFIG_QUERYLOG_H
+#define PKG_CONFIG_QUERYLOG_H
+
+#include <glib.h>
+
+/* Start a PKG_CONFIG_LOG record for this invocation, to be appended to
+ * PATH when pkg-config exits.  ARGV is copied, so this has to be called
+ * before the options are parsed.  Exits if PATH cannot be opened.
+ */
+void querylog_open (const char *path, int argc, char **argv);
+
+/* Note a module requested on the command line, with the version
+ * constraint COMPARISON and VERSION (or NULL), and whether it was
+ * found.  Does nothing without a log. */
+void querylog_module (const char *name, const char *comparison,
+                      const char *version, gboolean found);
+
+#endif
@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2026 pkg-config contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "pkg.h"
+#include "resolve.h"
+#include "stats.h"
+
+#include <string.h>
+#include <errno.h>
+#include <ctype.h>
+
+/* Directory name => set of file names in it.  Each directory is read
+ * at most once per run, so resolving hundreds of -l flags against the
+ * same handful of directories costs one readdir per directory rather
+ * than one stat per (flag, directory) pair.  Unreadable directories
+ * map to NULL.
+ */
+static GHashTable *dir_index = NULL;
+
+static GList *system_dirs = NULL;
+
+static GHashTable *
+get_dir_entries (const char *dirname)
+{
+  GHashTable *entries;
+  GDir *dir;
+  const gchar *filename;
+
+  if (dir_index == NULL)
+    dir_index = g_hash_table_new (g_str_hash, g_str_equal);
+
+  if (g_hash_table_lookup_extended (dir_index, dirname, NULL,
+                                    (gpointer *) &entries))
+    return entries;
+
+  stats_add (STAT_DIRS_READ, 1);
+  dir = g_dir_open (dirname, 0, NULL);
+  if (dir == NULL)
+    {
+      debug_log (LOG_FLAGS, "Cannot open library directory '%s': %s\n",
+                 dirname, g_strerror (errno));
+      g_hash_table_insert (dir_index, g_strdup (dirname), NULL);
+      return NULL;
+    }
+
+  debug_log (LOG_FLAGS, "Indexing library directory '%s'\n", dirname);
+
+  entries = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  while ((filename = g_dir_read_name (dir)))
+    g_hash_table_add (entries, g_strdup (filename));
+  g_dir_close (dir);
+
+  g_hash_table_insert (dir_index, g_strdup (dirname), entries);
+
+  return entries;
+}
+
+const char *
+lib_dir_from_flag (const char *arg)
+{
+  if (strncmp (arg, "-L", 2) != 0)
+    return NULL;
+
+  arg += 2;
+  while (*arg && isspace ((guchar)*arg))
+    arg++;
+
+  return arg;
+}
+
+const char *
+lib_name_from_flag (const char *arg)
+{
+  if (strncmp (arg, "-l", 2) != 0)
+    return NULL;
+
+  arg += 2;
+  while (*arg && isspace ((guchar)*arg))
+    arg++;
+
+  return arg;
+}
+
+char *
+resolve_library (const char *name, GList *dirs, gboolean want_static)
+{
+  char *shared = NULL;
+  char *archive = NULL;
+  char *retval = NULL;
+
+  /* -l:filename asks for an exact file name */
+  if (name[0] == ':')
+    shared = g_strdup (name + 1);
+  else
+    {
+      shared = g_strconcat ("lib", name, ".so", NULL);
+      archive = g_strconcat ("lib", name, ".a", NULL);
+    }
+
+  /* The linker checks each directory for the shared library and then
+   * the archive before moving on to the next directory. */
+  for (; dirs != NULL && retval == NULL; dirs = g_list_next (dirs))
+    {
+      const char *dirname = dirs->data;
+      GHashTable *entries = get_dir_entries (dirname);
+
+      if (entries == NULL)
+        continue;
+
+      if (archive == NULL)
+        {
+          if (g_hash_table_contains (entries, shared))
+            retval = g_build_filename (dirname, shared, NULL);
+        }
+      else if (!want_static && g_hash_table_contains (entries, shared))
+        retval = g_build_filename (dirname, shared, NULL);
+      else if (g_hash_table_contains (entries, archive))
+        retval = g_build_filename (dirname, archive, NULL);
+    }
+
+  g_free (shared);
+  g_free (archive);
+
+  return retval;
+}
+
+GList *
+system_library_dirs (void)
+{
+  const char *search_path;
+  char **values;
+  int i;
+
+  if (system_dirs != NULL)
+    return system_dirs;
+
+  search_path = g_getenv ("PKG_CONFIG_SYSTEM_LIBRARY_PATH");
+  if (search_path == NULL)
+    search_path = PKG_CONFIG_SYSTEM_LIBRARY_PATH;
+
+  values = g_strsplit (search_path, G_SEARCHPATH_SEPARATOR_S, 0);
+  for (i = 0; values[i] != NULL; i++)
+    if (*values[i] != '\0')
+      system_dirs = g_list_append (system_dirs, g_strdup (values[i]));
+  g_strfreev (values);
+
+  return system_dirs;
+}
@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2026 pkg-config contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef PKG_CONFIG_RESOLVE_H
+#define PKG_CONFIG_RESOLVE_H
+
+#include <glib.h>
+
+/* Return the directory from an -L flag, without the sysroot. */
+const char *lib_dir_from_flag (const char *arg);
+
+/* Return the library name from an -l flag, e.g. "foo" for "-lfoo" and
+ * ":libfoo.so.1" for "-l:libfoo.so.1". */
+const char *lib_name_from_flag (const char *arg);
+
+/* Look up library NAME in DIRS (a list of directory names, searched in
+ * order), the way the linker would.  Static lookups only consider
+ * archives.  Returns a newly allocated absolute path or NULL.
+ */
+char *resolve_library (const char *name, GList *dirs, gboolean want_static);
+
+/* Directories from PKG_CONFIG_SYSTEM_LIBRARY_PATH, or the built-in
+ * default.  The list is owned by the resolver. */
+GList *system_library_dirs (void);
+
+#endif
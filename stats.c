@@ -0,0 +1,263 @@
+/*
+ * Copyright (C) 2026 pkg-config contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/* Counters of what an invocation did, for --stats.  Allocations are
+ * counted through GLib's memory vtable, which must be installed before
+ * the first allocation, so stats_init looks for --stats in the
+ * arguments and environment before they are parsed.  GLib 2.46 and
+ * later ignore the vtable; the allocations are then reported as null.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "stats.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Room before each block for its size, keeping the block aligned for
+ * any type */
+#define ALLOC_HEADER 16
+
+gboolean want_stats = FALSE;
+volatile gsize stats_counters[N_STATS];
+
+static const char *counter_names[N_STATS] = {
+  "dirs_probed",
+  "dirs_read",
+  "stat_calls",
+  "files_opened",
+  "bytes_read",
+  "lines_parsed",
+  "variables_expanded",
+  "flags_created",
+  "hash_lookups",
+  "version_comparisons",
+  "duplicates_removed",
+  "packages_loaded",
+  "cache_hits",
+  "index_hits",
+  "conflict_checks",
+  "graph_visits",
+  "list_steps",
+};
+
+static gboolean counting_allocs = FALSE;
+static volatile gsize alloc_count = 0;
+static volatile gsize alloc_total = 0;
+static volatile gsize alloc_current = 0;
+static volatile gsize alloc_peak = 0;
+static char *output_file = NULL;
+static gboolean reporting = FALSE;
+
+#if !GLIB_CHECK_VERSION(2, 46, 0)
+
+static void
+account (gssize delta, gboolean new_block)
+{
+  gsize current;
+  gsize peak;
+
+  if (new_block)
+    g_atomic_pointer_add (&alloc_count, 1);
+  if (delta > 0)
+    g_atomic_pointer_add (&alloc_total, delta);
+  current = g_atomic_pointer_add (&alloc_current, delta) + delta;
+
+  do
+    peak = (gsize) g_atomic_pointer_get (&alloc_peak);
+  while (current > peak &&
+         !g_atomic_pointer_compare_and_exchange (&alloc_peak,
+                                                 (gpointer) peak,
+                                                 (gpointer) current));
+}
+
+static gpointer
+stats_malloc (gsize n_bytes)
+{
+  char *mem = malloc (n_bytes + ALLOC_HEADER);
+
+  if (mem == NULL)
+    return NULL;
+  *(gsize *) mem = n_bytes;
+  account (n_bytes, TRUE);
+
+  return mem + ALLOC_HEADER;
+}
+
+static gpointer
+stats_calloc (gsize n_blocks, gsize n_block_bytes)
+{
+  gsize n_bytes = n_blocks * n_block_bytes;
+  char *mem;
+
+  if (n_block_bytes != 0 && n_bytes / n_block_bytes != n_blocks)
+    return NULL;
+  mem = calloc (1, n_bytes + ALLOC_HEADER);
+  if (mem == NULL)
+    return NULL;
+  *(gsize *) mem = n_bytes;
+  account (n_bytes, TRUE);
+
+  return mem + ALLOC_HEADER;
+}
+
+static gpointer
+stats_realloc (gpointer mem, gsize n_bytes)
+{
+  char *block;
+  gsize old_bytes;
+
+  if (mem == NULL)
+    return stats_malloc (n_bytes);
+
+  block = (char *) mem - ALLOC_HEADER;
+  old_bytes = *(gsize *) block;
+  block = realloc (block, n_bytes + ALLOC_HEADER);
+  if (block == NULL)
+    return NULL;
+  *(gsize *) block = n_bytes;
+  account ((gssize) n_bytes - (gssize) old_bytes, FALSE);
+
+  return block + ALLOC_HEADER;
+}
+
+static void
+stats_free (gpointer mem)
+{
+  char *block;
+
+  if (mem == NULL)
+    return;
+
+  block = (char *) mem - ALLOC_HEADER;
+  account (-(gssize) *(gsize *) block, FALSE);
+  free (block);
+}
+
+#endif
+
+void
+stats_init (int argc, char **argv)
+{
+  gboolean wanted = getenv ("PKG_CONFIG_STATS") != NULL;
+  int i;
+
+  for (i = 1; i < argc && !wanted && strcmp (argv[i], "--") != 0; i++)
+    wanted = strcmp (argv[i], "--stats") == 0 ||
+      strncmp (argv[i], "--stats-file", strlen ("--stats-file")) == 0 ||
+      strncmp (argv[i], "--benchmark", strlen ("--benchmark")) == 0 ||
+      strncmp (argv[i], "--memory-stats", strlen ("--memory-stats")) == 0;
+
+  if (!wanted)
+    return;
+
+#if !GLIB_CHECK_VERSION(2, 46, 0)
+  {
+    GMemVTable vtable = {
+      stats_malloc,
+      stats_realloc,
+      stats_free,
+      stats_calloc,
+      NULL,
+      NULL,
+    };
+
+    g_mem_set_vtable (&vtable);
+    counting_allocs = !g_mem_is_system_malloc ();
+  }
+#endif
+}
+
+gboolean
+stats_get_allocations (gsize *count, gsize *total_bytes)
+{
+  *count = (gsize) g_atomic_pointer_get (&alloc_count);
+  *total_bytes = (gsize) g_atomic_pointer_get (&alloc_total);
+
+  return counting_allocs;
+}
+
+gboolean
+stats_get_peak (gsize *peak_bytes, gsize *live_bytes)
+{
+  *peak_bytes = (gsize) g_atomic_pointer_get (&alloc_peak);
+  *live_bytes = (gsize) g_atomic_pointer_get (&alloc_current);
+
+  return counting_allocs;
+}
+
+static void
+stats_report (void)
+{
+  GString *out = g_string_new ("{");
+  FILE *stream = stderr;
+  int i;
+
+  for (i = 0; i < N_STATS; i++)
+    g_string_append_printf (out, "%s\"%s\":%" G_GSIZE_FORMAT,
+                            i > 0 ? "," : "", counter_names[i],
+                            stats_get (i));
+
+  if (counting_allocs)
+    g_string_append_printf (out, ",\"allocations\":{\"count\":%" G_GSIZE_FORMAT
+                            ",\"total_bytes\":%" G_GSIZE_FORMAT
+                            ",\"peak_bytes\":%" G_GSIZE_FORMAT "}}\n",
+                            alloc_count, alloc_total, alloc_peak);
+  else
+    g_string_append (out, ",\"allocations\":null}\n");
+
+  if (output_file != NULL && (stream = fopen (output_file, "a")) == NULL)
+    {
+      fprintf (stderr, "Cannot open stats file: %s\n", output_file);
+      stream = stderr;
+    }
+  fwrite (out->str, 1, out->len, stream);
+  fflush (stream);
+  if (stream != stderr)
+    fclose (stream);
+
+  g_string_free (out, TRUE);
+}
+
+void
+stats_enable (const char *file)
+{
+  if (file != NULL && *file != '\0')
+    {
+      g_free (output_file);
+      output_file = g_strdup (file);
+    }
+
+  want_stats = TRUE;
+  if (!reporting)
+    {
+      reporting = TRUE;
+      atexit (stats_report);
+    }
+}
+
+void
+stats_collect (void)
+{
+  want_stats = TRUE;
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2026 pkg-config contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef PKG_CONFIG_STATS_H
+#define PKG_CONFIG_STATS_H
+
+#include <glib.h>
+
+/* Operation counters for --stats */
+typedef enum
+{
+  STAT_DIRS_PROBED,        /* search directories tried for a .pc file */
+  STAT_DIRS_READ,          /* directories listed */
+  STAT_STAT_CALLS,         /* files tested for existence */
+  STAT_FILES_OPENED,
+  STAT_BYTES_READ,
+  STAT_LINES_PARSED,
+  STAT_VARIABLES_EXPANDED,
+  STAT_FLAGS_CREATED,
+  STAT_HASH_LOOKUPS,       /* of packages and variables */
+  STAT_VERSION_COMPARISONS,
+  STAT_DUPLICATES_REMOVED,
+  STAT_PACKAGES_LOADED,
+  STAT_CACHE_HITS,         /* packages found already loaded */
+  STAT_INDEX_HITS,         /* up to date requires indexes used */
+  STAT_CONFLICT_CHECKS,    /* Conflicts entries tested against packages */
+  STAT_GRAPH_VISITS,       /* packages visited walking the requires graph */
+  STAT_LIST_STEPS,         /* flags walked removing system directories */
+  N_STATS
+} StatCounter;
+
+extern gboolean want_stats;
+/* Pointer sized, so that large trees and long --benchmark runs don't
+ * overflow them on 64-bit hosts. */
+extern volatile gsize stats_counters[N_STATS];
+
+/* Add N to COUNTER, if counting.  Safe to use from any thread. */
+#define stats_add(counter, n) G_STMT_START {                    \
+    if (want_stats)                                             \
+      g_atomic_pointer_add (&stats_counters[counter], (n));    \
+  } G_STMT_END
+
+/* The current value of COUNTER */
+#define stats_get(counter) \
+  ((gsize) g_atomic_pointer_get (&stats_counters[counter]))
+
+/* Set up allocation accounting if ARGV or the environment ask for
+ * --stats, --benchmark or --memory-stats.  This has to come before
+ * anything else uses GLib. */
+void stats_init (int argc, char **argv);
+
+/* Start counting and print the counters as a JSON object when
+ * pkg-config exits, appending it to FILE, or to standard error if FILE
+ * is NULL. */
+void stats_enable (const char *file);
+
+/* Start counting without printing anything, for users of the counters
+ * such as the query log. */
+void stats_collect (void);
+
+/* Store the number of allocations made so far and their total size in
+ * COUNT and TOTAL_BYTES.  Returns FALSE if allocations aren't counted,
+ * because stats_init didn't ask for it or GLib can't do it. */
+gboolean stats_get_allocations (gsize *count, gsize *total_bytes);
+
+/* The most bytes allocated at once so far, and now, as above. */
+gboolean stats_get_peak (gsize *peak_bytes, gsize *live_bytes);
+
+#endif
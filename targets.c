@@ -0,0 +1,371 @@
+/*
+ * Copyright (C) 2026 pkg-config contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/* --target: resolve the same query against several sysroots and search
+ * paths in one invocation.  The sysroot, search path and loaded packages
+ * are global to the process, so each target is resolved by running
+ * pkg-config again with that target's environment, from a pool of
+ * threads so that they run in parallel.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "targets.h"
+#include "json.h"
+#include "pkg.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifndef G_OS_WIN32
+#include <sys/wait.h>
+#endif
+
+typedef struct
+{
+  char *name;
+  char **envp;
+  /* the results */
+  char *output;
+  char *errors;
+  int exit_status;
+} Target;
+
+static char **saved_argv = NULL;
+static GPtrArray *targets = NULL;
+
+/* The environment variables behind each key of a target */
+static const struct
+{
+  const char *key;
+  const char *variable;
+} target_keys[] = {
+  { "sysroot", "PKG_CONFIG_SYSROOT_DIR" },
+  { "libdir", "PKG_CONFIG_LIBDIR" },
+  { "path", "PKG_CONFIG_PATH" },
+};
+
+/* Options reporting on the whole run, which only the parent acts on;
+ * each child would otherwise report too, or overwrite the same file.
+ * TAKES_VALUE is set for options whose value may be the next
+ * argument. */
+static const struct
+{
+  const char *name;
+  gboolean takes_value;
+} report_options[] = {
+  { "--trace", TRUE },
+  { "--stats", FALSE },
+  { "--stats-file", TRUE },
+  { "--timings", FALSE },
+  { "--timings-file", TRUE },
+  { "--memory-stats", FALSE },
+};
+
+/* ... and the environment variables doing the same */
+static const char *report_variables[] = {
+  "PKG_CONFIG_LOG",
+  "PKG_CONFIG_STATS",
+  "PKG_CONFIG_STATS_FILE",
+  "PKG_CONFIG_TIMINGS",
+  "PKG_CONFIG_TIMINGS_FILE",
+};
+
+/* The number of arguments starting at ARGV that form a report option,
+ * or 0 if ARGV[0] isn't one */
+static int
+report_option_args (char **argv)
+{
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (report_options); i++)
+    {
+      gsize len = strlen (report_options[i].name);
+
+      if (strncmp (argv[0], report_options[i].name, len) != 0)
+        continue;
+      if (argv[0][len] == '=')
+        return 1;
+      if (argv[0][len] == '\0')
+        return report_options[i].takes_value && argv[1] != NULL ? 2 : 1;
+    }
+
+  return 0;
+}
+
+static gboolean
+is_report_variable (const char *name)
+{
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (report_variables); i++)
+    if (strcmp (name, report_variables[i]) == 0)
+      return TRUE;
+
+  return FALSE;
+}
+
+static gboolean
+is_target_arg (const char *arg)
+{
+  return strcmp (arg, "--target") == 0 ||
+    strncmp (arg, "--target=", strlen ("--target=")) == 0;
+}
+
+void
+targets_init (int argc, char **argv)
+{
+  int i;
+
+  for (i = 1; i < argc && strcmp (argv[i], "--") != 0; i++)
+    if (is_target_arg (argv[i]))
+      {
+        saved_argv = g_new0 (char *, argc + 1);
+        memcpy (saved_argv, argv, argc * sizeof (char *));
+        return;
+      }
+}
+
+static const char *
+target_variable (const char *key)
+{
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (target_keys); i++)
+    if (strcmp (key, target_keys[i].key) == 0)
+      return target_keys[i].variable;
+
+  return NULL;
+}
+
+/* The environment of this process with the variables of SETTINGS
+ * replaced, and without the report variables; an empty value unsets a
+ * variable */
+static char **
+target_environment (char **settings)
+{
+  GPtrArray *envp = g_ptr_array_new ();
+  char **names = g_listenv ();
+  int i, j;
+
+  for (i = 0; names[i] != NULL; i++)
+    {
+      gboolean replaced = is_report_variable (names[i]);
+
+      for (j = 0; settings[j] != NULL && !replaced; j++)
+        {
+          const char *eq = strchr (settings[j], '=');
+          char *key = g_strndup (settings[j], eq - settings[j]);
+
+          replaced = strcmp (names[i], target_variable (key)) == 0;
+          g_free (key);
+        }
+      if (!replaced)
+        g_ptr_array_add (envp, g_strconcat (names[i], "=",
+                                            g_getenv (names[i]), NULL));
+    }
+  for (j = 0; settings[j] != NULL; j++)
+    {
+      const char *eq = strchr (settings[j], '=');
+      char *key = g_strndup (settings[j], eq - settings[j]);
+
+      if (eq[1] != '\0')
+        g_ptr_array_add (envp, g_strconcat (target_variable (key), eq,
+                                            NULL));
+      g_free (key);
+    }
+  g_ptr_array_add (envp, NULL);
+  g_strfreev (names);
+
+  return (char **) g_ptr_array_free (envp, FALSE);
+}
+
+gboolean
+targets_add (const char *spec)
+{
+  const char *colon = strchr (spec, ':');
+  char **settings;
+  Target *target;
+  guint i;
+  int j;
+
+  if (colon == NULL || colon == spec)
+    return FALSE;
+  for (i = 0; targets != NULL && i < targets->len; i++)
+    {
+      Target *other = g_ptr_array_index (targets, i);
+
+      if (strlen (other->name) == (gsize) (colon - spec) &&
+          strncmp (other->name, spec, colon - spec) == 0)
+        return FALSE;
+    }
+
+  /* Paths are separated by colons, so the settings are separated by
+   * commas */
+  settings = colon[1] != '\0' ? g_strsplit (colon + 1, ",", -1)
+    : g_new0 (char *, 1);
+  for (j = 0; settings[j] != NULL; j++)
+    {
+      const char *eq = strchr (settings[j], '=');
+      char *key;
+      gboolean known;
+
+      if (eq == NULL)
+        {
+          g_strfreev (settings);
+          return FALSE;
+        }
+      key = g_strndup (settings[j], eq - settings[j]);
+      known = target_variable (key) != NULL;
+      g_free (key);
+      if (!known)
+        {
+          g_strfreev (settings);
+          return FALSE;
+        }
+    }
+
+  target = g_new0 (Target, 1);
+  target->name = g_strndup (spec, colon - spec);
+  target->envp = target_environment (settings);
+  g_strfreev (settings);
+
+  if (targets == NULL)
+    targets = g_ptr_array_new ();
+  g_ptr_array_add (targets, target);
+
+  return TRUE;
+}
+
+gboolean
+targets_wanted (void)
+{
+  return targets != NULL && saved_argv != NULL;
+}
+
+/* The command line without the --target and report options */
+static char **
+target_argv (void)
+{
+  GPtrArray *args = g_ptr_array_new ();
+  int i;
+  int n;
+
+  for (i = 0; saved_argv[i] != NULL; i++)
+    {
+      if (strcmp (saved_argv[i], "--") == 0)
+        {
+          for (; saved_argv[i] != NULL; i++)
+            g_ptr_array_add (args, saved_argv[i]);
+          break;
+        }
+      if (strcmp (saved_argv[i], "--target") == 0 && saved_argv[i + 1])
+        i++;
+      else if (i > 0 && (n = report_option_args (saved_argv + i)) > 0)
+        i += n - 1;
+      else if (!is_target_arg (saved_argv[i]))
+        g_ptr_array_add (args, saved_argv[i]);
+    }
+  g_ptr_array_add (args, NULL);
+
+  return (char **) g_ptr_array_free (args, FALSE);
+}
+
+static void
+run_job (gpointer data, gpointer user_data)
+{
+  Target *target = data;
+  char **argv = user_data;
+  GSpawnFlags flags = 0;
+  GError *error = NULL;
+  int wait_status;
+
+  /* a bare program name was found in PATH */
+  if (strchr (argv[0], G_DIR_SEPARATOR) == NULL)
+    flags |= G_SPAWN_SEARCH_PATH;
+
+  debug_log (LOG_GENERAL, "Resolving target '%s'\n", target->name);
+  if (!g_spawn_sync (NULL, argv, target->envp, flags, NULL, NULL,
+                     &target->output, &target->errors, &wait_status,
+                     &error))
+    {
+      target->output = g_strdup ("");
+      target->errors = g_strdup_printf ("%s\n", error->message);
+      target->exit_status = 1;
+      g_error_free (error);
+      return;
+    }
+
+#ifdef G_OS_WIN32
+  target->exit_status = wait_status;
+#else
+  target->exit_status = WIFEXITED (wait_status) ?
+    WEXITSTATUS (wait_status) : 1;
+#endif
+}
+
+int
+targets_run (void)
+{
+  char **argv = target_argv ();
+  GThreadPool *pool = NULL;
+  GString *out = g_string_new ("{\"targets\":[");
+  guint threads;
+  guint i;
+  int status = 0;
+
+  threads = MIN (g_get_num_processors (), targets->len);
+  if (threads > 1)
+    pool = g_thread_pool_new (run_job, argv, threads, TRUE, NULL);
+  for (i = 0; i < targets->len; i++)
+    {
+      if (pool != NULL)
+        g_thread_pool_push (pool, g_ptr_array_index (targets, i), NULL);
+      else
+        run_job (g_ptr_array_index (targets, i), argv);
+    }
+  if (pool != NULL)
+    g_thread_pool_free (pool, FALSE, TRUE);
+
+  for (i = 0; i < targets->len; i++)
+    {
+      Target *target = g_ptr_array_index (targets, i);
+
+      g_string_append (out, i > 0 ? ",{\"name\":" : "{\"name\":");
+      json_append_string (out, target->name);
+      g_string_append_printf (out, ",\"exit\":%d,\"output\":",
+                              target->exit_status);
+      json_append_string (out, target->output);
+      g_string_append (out, ",\"errors\":");
+      json_append_string (out, target->errors);
+      g_string_append_c (out, '}');
+
+      if (target->exit_status != 0)
+        status = 1;
+    }
+  g_string_append (out, "]}\n");
+  fwrite (out->str, 1, out->len, stdout);
+
+  g_string_free (out, TRUE);
+  g_free (argv);
+
+  return status;
+}
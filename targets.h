@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2026 pkg-config contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef PKG_CONFIG_TARGETS_H
+#define PKG_CONFIG_TARGETS_H
+
+#include <glib.h>
+
+/* Keep a copy of the command line if it asks for --target, to pass on
+ * to the processes resolving each target.  Call it before the options
+ * are parsed. */
+void targets_init (int argc, char **argv);
+
+/* Add the target described by SPEC, NAME:KEY=VALUE,... where the keys
+ * are sysroot, libdir and path.  Returns FALSE if SPEC is malformed or
+ * NAME is taken. */
+gboolean targets_add (const char *spec);
+
+gboolean targets_wanted (void);
+
+/* Run the query for every target in parallel and print the results as
+ * one JSON object.  Returns the exit status. */
+int targets_run (void);
+
+#endif
@@ -0,0 +1,285 @@
+/*
+ * Copyright (C) 2026 pkg-config contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/* Wall and CPU time per phase of an invocation, for --timings.  The
+ * phases form a stack on the main thread; time is charged to the phase
+ * on top whenever it changes.  Parsing done by worker threads only
+ * shows up in the per-file times and in the CPU time of the phase the
+ * main thread is waiting in.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "timings.h"
+#include "json.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* How many of the slowest .pc files are reported */
+#define SLOWEST_FILES 10
+
+typedef struct
+{
+  gint64 wall;
+  gint64 cpu;
+  guint count;
+} PhaseTime;
+
+typedef struct
+{
+  char *path;
+  gint64 usec;
+} FileTime;
+
+gboolean want_timings = FALSE;
+
+static const char *phase_names[N_PHASES] = {
+  "other",
+  "search-path",
+  "options",
+  "lookup",
+  "read",
+  "parse",
+  "requires",
+  "verify",
+  "merge",
+  "output",
+};
+
+static PhaseTime phases[N_PHASES];
+static GArray *stack = NULL;
+static GThread *main_thread = NULL;
+static gint64 start_wall, start_cpu;
+static gint64 last_wall, last_cpu;
+
+static GMutex files_lock;
+static GArray *files = NULL;
+
+static gboolean json_output = FALSE;
+static char *output_file = NULL;
+
+static gint64
+cpu_now (void)
+{
+  return (gint64) clock () * G_USEC_PER_SEC / CLOCKS_PER_SEC;
+}
+
+static void
+charge (TimingPhase phase)
+{
+  gint64 wall = g_get_monotonic_time ();
+  gint64 cpu = cpu_now ();
+
+  phases[phase].wall += wall - last_wall;
+  phases[phase].cpu += cpu - last_cpu;
+  last_wall = wall;
+  last_cpu = cpu;
+}
+
+static TimingPhase
+current_phase (void)
+{
+  if (stack->len == 0)
+    return PHASE_OTHER;
+  return g_array_index (stack, TimingPhase, stack->len - 1);
+}
+
+void
+timings_start (void)
+{
+  stack = g_array_new (FALSE, FALSE, sizeof (TimingPhase));
+  files = g_array_new (FALSE, FALSE, sizeof (FileTime));
+  main_thread = g_thread_self ();
+  start_wall = last_wall = g_get_monotonic_time ();
+  start_cpu = last_cpu = cpu_now ();
+}
+
+void
+timings_mark (TimingPhase phase)
+{
+  charge (phase);
+  phases[phase].count++;
+}
+
+void
+timings_push (TimingPhase phase)
+{
+  if (!want_timings || g_thread_self () != main_thread)
+    return;
+
+  charge (current_phase ());
+  g_array_append_val (stack, phase);
+  phases[phase].count++;
+}
+
+void
+timings_pop (void)
+{
+  if (!want_timings || g_thread_self () != main_thread)
+    return;
+
+  charge (current_phase ());
+  g_array_set_size (stack, stack->len - 1);
+}
+
+void
+timings_file (const char *path, gint64 usec)
+{
+  FileTime file;
+
+  if (!want_timings)
+    return;
+
+  file.path = g_strdup (path);
+  file.usec = usec;
+  g_mutex_lock (&files_lock);
+  g_array_append_val (files, file);
+  g_mutex_unlock (&files_lock);
+}
+
+static gint
+file_time_cmp (gconstpointer a, gconstpointer b)
+{
+  const FileTime *fa = a;
+  const FileTime *fb = b;
+
+  if (fa->usec != fb->usec)
+    return fa->usec > fb->usec ? -1 : 1;
+  return strcmp (fa->path, fb->path);
+}
+
+static void
+format_text (GString *out, gint64 wall, gint64 cpu)
+{
+  int i;
+  guint n;
+
+  g_string_append_printf (out, "%-12s %10s %10s %6s\n",
+                          "Phase", "Wall (ms)", "CPU (ms)", "Count");
+  for (i = 0; i < N_PHASES; i++)
+    g_string_append_printf (out, "%-12s %10.3f %10.3f %6u\n", phase_names[i],
+                            phases[i].wall / 1000.0, phases[i].cpu / 1000.0,
+                            phases[i].count);
+  g_string_append_printf (out, "%-12s %10.3f %10.3f\n", "total",
+                          wall / 1000.0, cpu / 1000.0);
+
+  if (files->len == 0)
+    return;
+  g_string_append (out, "Slowest files (ms):\n");
+  for (n = 0; n < files->len && n < SLOWEST_FILES; n++)
+    {
+      FileTime *file = &g_array_index (files, FileTime, n);
+
+      g_string_append_printf (out, "%10.3f %s\n", file->usec / 1000.0,
+                              file->path);
+    }
+}
+
+static void
+format_json (GString *out, gint64 wall, gint64 cpu)
+{
+  int i;
+  guint n;
+
+  g_string_append_printf (out, "{\"wall_us\":%" G_GINT64_FORMAT
+                          ",\"cpu_us\":%" G_GINT64_FORMAT ",\"phases\":{",
+                          wall, cpu);
+  for (i = 0; i < N_PHASES; i++)
+    g_string_append_printf (out, "%s\"%s\":{\"wall_us\":%" G_GINT64_FORMAT
+                            ",\"cpu_us\":%" G_GINT64_FORMAT ",\"count\":%u}",
+                            i > 0 ? "," : "", phase_names[i],
+                            phases[i].wall, phases[i].cpu, phases[i].count);
+  g_string_append (out, "},\"slowest_files\":[");
+  for (n = 0; n < files->len && n < SLOWEST_FILES; n++)
+    {
+      FileTime *file = &g_array_index (files, FileTime, n);
+
+      if (n > 0)
+        g_string_append_c (out, ',');
+      g_string_append (out, "{\"path\":");
+      json_append_string (out, file->path);
+      g_string_append_printf (out, ",\"wall_us\":%" G_GINT64_FORMAT "}",
+                              file->usec);
+    }
+  g_string_append (out, "]}\n");
+}
+
+static void
+timings_report (void)
+{
+  GString *out = g_string_new (NULL);
+  FILE *stream = stderr;
+
+  charge (current_phase ());
+
+  g_mutex_lock (&files_lock);
+  g_array_sort (files, file_time_cmp);
+  if (json_output)
+    format_json (out, last_wall - start_wall, last_cpu - start_cpu);
+  else
+    format_text (out, last_wall - start_wall, last_cpu - start_cpu);
+  g_mutex_unlock (&files_lock);
+
+  /* Reports are appended, so a file can collect those of a whole
+   * build. */
+  if (output_file != NULL && (stream = fopen (output_file, "a")) == NULL)
+    {
+      fprintf (stderr, "Cannot open timings file: %s\n", output_file);
+      stream = stderr;
+    }
+  fwrite (out->str, 1, out->len, stream);
+  fflush (stream);
+  if (stream != stderr)
+    fclose (stream);
+
+  g_string_free (out, TRUE);
+}
+
+gboolean
+timings_enable (const char *format, const char *file)
+{
+  if (format == NULL)
+    ;
+  else if (*format == '\0' || strcmp (format, "text") == 0 ||
+           strcmp (format, "1") == 0)
+    json_output = FALSE;
+  else if (strcmp (format, "json") == 0)
+    json_output = TRUE;
+  else
+    return FALSE;
+
+  if (file != NULL && *file != '\0')
+    {
+      g_free (output_file);
+      output_file = g_strdup (file);
+    }
+
+  if (!want_timings)
+    {
+      want_timings = TRUE;
+      atexit (timings_report);
+    }
+
+  return TRUE;
+}
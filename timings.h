@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2026 pkg-config contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef PKG_CONFIG_TIMINGS_H
+#define PKG_CONFIG_TIMINGS_H
+
+#include <glib.h>
+
+/* The phases of an invocation, for --timings.  Each one only gets the
+ * time not spent in a phase nested in it, so that they add up to the
+ * total: the requires phase of a package does not include looking up
+ * and parsing its dependencies, for instance. */
+typedef enum
+{
+  PHASE_OTHER,
+  PHASE_SEARCH_PATH,
+  PHASE_OPTIONS,
+  PHASE_LOOKUP,
+  PHASE_READ,
+  PHASE_PARSE,
+  PHASE_REQUIRES,
+  PHASE_VERIFY,
+  PHASE_MERGE,
+  PHASE_OUTPUT,
+  N_PHASES
+} TimingPhase;
+
+extern gboolean want_timings;
+
+/* Start the clock, at the very beginning of main. */
+void timings_start (void);
+
+/* Report the timings when pkg-config exits, in FORMAT, "text" or "json",
+ * to FILE or standard error.  A NULL FORMAT or FILE leaves the one of an
+ * earlier call, text and standard error by default.  Returns FALSE if
+ * FORMAT is unknown. */
+gboolean timings_enable (const char *format, const char *file);
+
+/* Charge the time since the last phase change to PHASE.  Unlike the
+ * rest, this works before timings are enabled, for the phases that
+ * decide whether they are. */
+void timings_mark (TimingPhase phase);
+
+/* Enter and leave PHASE, nested in the current one. */
+void timings_push (TimingPhase phase);
+void timings_pop (void);
+
+/* Record that parsing the .pc file PATH took USEC microseconds.  Can be
+ * called from any thread. */
+void timings_file (const char *path, gint64 usec);
+
+#endif
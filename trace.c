@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2026 pkg-config contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/* Spans for --trace, as "B" and "E" trace events with microsecond
+ * timestamps.  Events from all threads go to one file under a lock;
+ * each thread gets a small id of its own, the main thread being 1.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "trace.h"
+#include "json.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+gboolean want_trace = FALSE;
+
+static FILE *trace_file = NULL;
+static GMutex trace_lock;
+static gint64 trace_start;
+static int pid = 0;
+static gint last_tid = 0;
+static GPrivate thread_id;
+
+static int
+current_tid (void)
+{
+  int tid = GPOINTER_TO_INT (g_private_get (&thread_id));
+
+  if (tid == 0)
+    {
+      tid = g_atomic_int_add (&last_tid, 1) + 1;
+      g_private_set (&thread_id, GINT_TO_POINTER (tid));
+    }
+
+  return tid;
+}
+
+static void
+trace_event (char phase, const char *name, const char *key, const char *path)
+{
+  GString *event = g_string_new (",\n{\"ph\":\"");
+
+  g_string_append_printf (event, "%c\",\"ts\":%" G_GINT64_FORMAT
+                          ",\"pid\":%d,\"tid\":%d", phase,
+                          g_get_monotonic_time () - trace_start, pid,
+                          current_tid ());
+  if (name != NULL)
+    {
+      g_string_append (event, ",\"name\":");
+      json_append_string (event, name);
+    }
+  if (key != NULL || path != NULL)
+    {
+      g_string_append (event, ",\"args\":{");
+      if (key != NULL)
+        {
+          g_string_append (event, "\"key\":");
+          json_append_string (event, key);
+        }
+      if (path != NULL)
+        {
+          g_string_append (event, key != NULL ? ",\"path\":" : "\"path\":");
+          json_append_string (event, path);
+        }
+      g_string_append_c (event, '}');
+    }
+  g_string_append_c (event, '}');
+
+  g_mutex_lock (&trace_lock);
+  if (trace_file != NULL)
+    fwrite (event->str, 1, event->len, trace_file);
+  g_mutex_unlock (&trace_lock);
+
+  g_string_free (event, TRUE);
+}
+
+static void
+trace_close (void)
+{
+  g_mutex_lock (&trace_lock);
+  fputs ("\n]}\n", trace_file);
+  fclose (trace_file);
+  trace_file = NULL;
+  want_trace = FALSE;
+  g_mutex_unlock (&trace_lock);
+}
+
+gboolean
+trace_open (const char *file)
+{
+  trace_file = fopen (file, "w");
+  if (trace_file == NULL)
+    return FALSE;
+
+#ifdef HAVE_UNISTD_H
+  pid = getpid ();
+#endif
+  trace_start = g_get_monotonic_time ();
+  current_tid ();
+
+  /* a metadata event first, so that every other one can start with a
+   * comma */
+  fprintf (trace_file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+           "{\"ph\":\"M\",\"pid\":%d,\"tid\":1,\"name\":\"thread_name\","
+           "\"args\":{\"name\":\"main\"}}", pid);
+
+  want_trace = TRUE;
+  atexit (trace_close);
+
+  return TRUE;
+}
+
+void
+trace_begin (const char *name, const char *key, const char *path)
+{
+  if (want_trace)
+    trace_event ('B', name, key, path);
+}
+
+void
+trace_end (const char *path)
+{
+  if (want_trace)
+    trace_event ('E', NULL, NULL, path);
+}
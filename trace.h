@@ -0,0 +1,40 @@
+/*
+ * Copyright (C) 2026 pkg-config contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef PKG_CONFIG_TRACE_H
+#define PKG_CONFIG_TRACE_H
+
+#include <glib.h>
+
+extern gboolean want_trace;
+
+/* Write trace events to FILE, in the Chrome trace event format that
+ * chrome://tracing and Perfetto load.  Returns FALSE if FILE cannot be
+ * written. */
+gboolean trace_open (const char *file);
+
+/* Begin a span NAME on the current thread, with the package KEY and
+ * file PATH as arguments if they are not NULL. */
+void trace_begin (const char *name, const char *key, const char *path);
+
+/* End the current thread's innermost span, adding PATH to its
+ * arguments if it is only known at the end. */
+void trace_end (const char *path);
+
+#endif
@@ -0,0 +1,324 @@
+/*
+ * Copyright (C) 2026 pkg-config contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/* --watch: stream the output of a query as .pc files change.  The
+ * search directories and the directories of the loaded packages are
+ * watched with inotify.  When .pc files change, the packages read from
+ * them, or which they could now shadow, are forgotten along with the
+ * packages requiring them, and the query is run again, so only those
+ * are parsed again.  Packages that cannot be loaded don't end the
+ * watch; they fail the query and are forgotten after it.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "watch.h"
+#include "pkg.h"
+#include "log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(HAVE_SYS_INOTIFY_H) && defined(HAVE_POLL_H)
+
+#include <errno.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#define WATCH_EVENTS (IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | \
+                      IN_CREATE | IN_DELETE | IN_ATTRIB)
+
+/* How long to wait for more events before running the query again, so
+ * that an install replacing many files is handled at once */
+#define SETTLE_MS 100
+
+static int inotify_fd = -1;
+static GHashTable *watched_dirs = NULL; /* watch descriptor to directory */
+/* Key to directory of the packages the last run loaded, which are the
+ * ones whose files matter */
+static GHashTable *closure = NULL;
+
+static void
+watch_dir (const char *dir)
+{
+  int wd = inotify_add_watch (inotify_fd, dir, WATCH_EVENTS | IN_ONLYDIR);
+
+  if (wd < 0)
+    {
+      debug_log (LOG_GENERAL, "Cannot watch directory '%s': %s\n", dir,
+                 g_strerror (errno));
+      return;
+    }
+  if (g_hash_table_lookup (watched_dirs, GINT_TO_POINTER (wd)) == NULL)
+    {
+      debug_log (LOG_GENERAL, "Watching directory '%s'\n", dir);
+      g_hash_table_insert (watched_dirs, GINT_TO_POINTER (wd),
+                           g_strdup (dir));
+    }
+}
+
+/* Watch the search path and wherever the packages came from, which
+ * differs for packages given as a file name */
+static void
+update_watches (void)
+{
+  GHashTableIter iter;
+  gpointer dir;
+  GList *tmp;
+
+  for (tmp = get_search_dirs (); tmp != NULL; tmp = g_list_next (tmp))
+    watch_dir (tmp->data);
+  g_hash_table_iter_init (&iter, closure);
+  while (g_hash_table_iter_next (&iter, NULL, &dir))
+    watch_dir (dir);
+}
+
+/* Replace the closure with the packages loaded so far */
+static void
+closure_from_loaded (void)
+{
+  GList *loaded = packages_get_loaded ();
+  GList *iter;
+
+  g_hash_table_remove_all (closure);
+  for (iter = loaded; iter != NULL; iter = g_list_next (iter))
+    {
+      Package *pkg = iter->data;
+
+      if (pkg->pcfiledir != NULL)
+        g_hash_table_insert (closure, g_strdup (pkg->key),
+                             g_strdup (pkg->pcfiledir));
+    }
+  g_list_free (loaded);
+}
+
+/* Run the query with its output going to a temporary file, and return
+ * that output.  The packages that failed to load are forgotten, so that
+ * they are read again by the next run. */
+static GString *
+capture_query (WatchQueryFunc query, const char *cmdline, int *status)
+{
+  GString *output = g_string_new (NULL);
+  FILE *tmp = tmpfile ();
+  char buf[4096];
+  ssize_t n;
+  int saved_stdout;
+
+  if (tmp == NULL)
+    {
+      fprintf (stderr, "Cannot create temporary file: %s\n",
+               g_strerror (errno));
+      exit (1);
+    }
+
+  fflush (stdout);
+  saved_stdout = dup (fileno (stdout));
+  dup2 (fileno (tmp), fileno (stdout));
+  *status = query (cmdline);
+  fflush (stdout);
+  dup2 (saved_stdout, fileno (stdout));
+  close (saved_stdout);
+
+  lseek (fileno (tmp), 0, SEEK_SET);
+  while ((n = read (fileno (tmp), buf, sizeof (buf))) > 0)
+    g_string_append_len (output, buf, n);
+  fclose (tmp);
+
+  packages_forget_failed ();
+  closure_from_loaded ();
+  log_flush ();
+
+  return output;
+}
+
+static void
+emit (GString *output)
+{
+  fwrite (output->str, 1, output->len, stdout);
+  fflush (stdout);
+}
+
+/* Add the keys of the packages that FILE in DIR may hold to KEYS */
+static GList *
+keys_for_file (GList *keys, const char *dir, const char *file)
+{
+  char *key = g_strndup (file, strlen (file) - strlen (".pc"));
+  GHashTableIter iter;
+  gpointer name, pcfiledir;
+
+  /* A new foo-uninstalled.pc takes the place of foo */
+  if (name_ends_in_uninstalled (key))
+    keys = g_list_prepend (keys, g_strndup (key, strlen (key) -
+                                            strlen ("-uninstalled")));
+  keys = g_list_prepend (keys, key);
+
+  /* Packages given as a file name are known by that name */
+  g_hash_table_iter_init (&iter, closure);
+  while (g_hash_table_iter_next (&iter, &name, &pcfiledir))
+    {
+      char *base;
+
+      if (!g_str_has_suffix (name, ".pc") || strcmp (pcfiledir, dir) != 0)
+        continue;
+      base = g_path_get_basename (name);
+      if (strcmp (base, file) == 0)
+        keys = g_list_prepend (keys, g_strdup (name));
+      g_free (base);
+    }
+
+  return keys;
+}
+
+/* Read the pending events, adding the keys of the packages affected to
+ * KEYS.  Sets OVERFLOW if events were lost. */
+static GList *
+read_events (GList *keys, gboolean *overflow)
+{
+  /* aligned for struct inotify_event */
+  guint64 storage[4096 / sizeof (guint64)];
+  char *buf = (char *) storage;
+  ssize_t len;
+  char *p;
+
+  len = read (inotify_fd, buf, sizeof (storage));
+  if (len < 0)
+    {
+      if (errno == EINTR)
+        return keys;
+      fprintf (stderr, "Cannot read file change events: %s\n",
+               g_strerror (errno));
+      exit (1);
+    }
+
+  for (p = buf; p < buf + len;
+       p += sizeof (struct inotify_event) + ((struct inotify_event *) p)->len)
+    {
+      struct inotify_event *event = (struct inotify_event *) p;
+      const char *dir;
+
+      if (event->mask & IN_Q_OVERFLOW)
+        {
+          *overflow = TRUE;
+          continue;
+        }
+      if (event->mask & IN_IGNORED)
+        {
+          /* the directory went away; it is watched again if it comes
+           * back in the directory of a package */
+          g_hash_table_remove (watched_dirs, GINT_TO_POINTER (event->wd));
+          continue;
+        }
+
+      dir = g_hash_table_lookup (watched_dirs, GINT_TO_POINTER (event->wd));
+      if (dir == NULL || event->len == 0 ||
+          !g_str_has_suffix (event->name, ".pc"))
+        continue;
+
+      debug_log (LOG_GENERAL, "File '%s' changed in '%s'\n", event->name,
+                 dir);
+      keys = keys_for_file (keys, dir, event->name);
+    }
+
+  return keys;
+}
+
+int
+watch_query (WatchQueryFunc query, const char *cmdline)
+{
+  GString *last;
+  int status;
+
+  inotify_fd = inotify_init ();
+  if (inotify_fd < 0)
+    {
+      fprintf (stderr, "Cannot watch for file changes: %s\n",
+               g_strerror (errno));
+      return 1;
+    }
+  watched_dirs = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+  closure = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+  packages_set_errors_fatal (FALSE);
+
+  last = capture_query (query, cmdline, &status);
+  emit (last);
+  update_watches ();
+
+  for (;;)
+    {
+      struct pollfd pfd = { inotify_fd, POLLIN, 0 };
+      GList *keys = NULL;
+      gboolean overflow = FALSE;
+      gboolean affected = FALSE;
+      GList *iter;
+      int n_forgotten;
+      GString *output;
+
+      keys = read_events (keys, &overflow);
+      while (poll (&pfd, 1, SETTLE_MS) > 0)
+        keys = read_events (keys, &overflow);
+
+      if (overflow)
+        {
+          debug_log (LOG_GENERAL, "Lost file change events, forgetting all "
+                     "packages\n");
+          package_reset ();
+          package_init (FALSE);
+          n_forgotten = 1;
+        }
+      else
+        n_forgotten = packages_forget (keys);
+      for (iter = keys; iter != NULL && !affected; iter = g_list_next (iter))
+        affected = g_hash_table_contains (closure, iter->data);
+      g_list_free_full (keys, g_free);
+
+      /* A query that failed may succeed with any new file */
+      if (n_forgotten == 0 && !affected && status == 0)
+        continue;
+
+      output = capture_query (query, cmdline, &status);
+      /* so that readers see the output go away */
+      if (status != 0 && output->len == 0)
+        g_string_append_c (output, '\n');
+      if (output->len != last->len || memcmp (output->str, last->str,
+                                              last->len) != 0)
+        {
+          emit (output);
+          g_string_free (last, TRUE);
+          last = output;
+        }
+      else
+        g_string_free (output, TRUE);
+      update_watches ();
+    }
+}
+
+#else
+
+int
+watch_query (WatchQueryFunc query, const char *cmdline)
+{
+  fprintf (stderr, "--watch is not supported on this platform\n");
+  return 1;
+}
+
+#endif
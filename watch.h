@@ -0,0 +1,35 @@
+/*
+ * Copyright (C) 2026 pkg-config contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef PKG_CONFIG_WATCH_H
+#define PKG_CONFIG_WATCH_H
+
+#include <glib.h>
+
+/* Runs the query on CMDLINE, printing its output and returning the exit
+ * status */
+typedef int (*WatchQueryFunc) (const char *cmdline);
+
+/* Run QUERY, print its output, then run it again each time a .pc file
+ * changes in the search path or in the directory of a loaded package,
+ * printing the output when it differs from the last one.  Only returns
+ * if watching fails, with the exit status. */
+int watch_query (WatchQueryFunc query, const char *cmdline);
+
+#endif